@@ -0,0 +1,33 @@
+export async function POST(request: Request) {
+    try {
+      const body = await request.json();
+      
+      const backendResponse = await fetch('http://13.36.148.227:3001/api/find-path/stream', {
+        method: 'POST',
+        headers: { 'Content-Type': 'application/json' },
+        body: JSON.stringify(body),
+      });
+  
+      if (!backendResponse.ok || !backendResponse.body) {
+        throw new Error(`Backend error: ${backendResponse.status}`);
+      }
+  
+      // Pass the NDJSON body through untouched so steps reach the client as they are produced
+      return new Response(backendResponse.body, {
+        status: 200,
+        headers: {
+          'Content-Type': 'application/x-ndjson',
+          'Cache-Control': 'no-cache',
+          'Access-Control-Allow-Origin': '*',
+          'Access-Control-Allow-Methods': 'POST'
+        }
+      });
+    } catch (error) {
+      return new Response(JSON.stringify({ 
+        error: error instanceof Error ? error.message : 'Failed to calculate path'
+      }), {
+        status: 500,
+        headers: { 'Content-Type': 'application/json' }
+      });
+    }
+  }
@@ -1,6 +1,6 @@
 "use client";
 
-import { useEffect, useState, useCallback } from "react";
+import { useEffect, useState, useRef } from "react";
 import { Plane, Loader2 } from "lucide-react";
 import FlightControls from "@/components/FlightControls";
 import AlgorithmVisualizer from "@/components/AlgorithmVisualizer";
@@ -49,6 +49,7 @@ interface PathResult {
   path: string[];
   totalDistance: number;
   steps: AlgorithmStep[];
+  approximate?: boolean; // cross-border route through thinned crossings
 }
 
 interface AlgorithmStep {
@@ -68,6 +69,7 @@ export default function Home() {
   const [isLoading, setIsLoading] = useState(false);
   const [currentStepIndex, setCurrentStepIndex] = useState(0);
   const [isAnimating, setIsAnimating] = useState(false);
+  const [isStreaming, setIsStreaming] = useState(false);
 
   useEffect(() => {
     fetchGraphData();
@@ -90,8 +92,10 @@ export default function Home() {
     }
   
     setIsLoading(true);
+    setPathResult(null);
+    setIsAnimating(false);
     try {
-      const response = await fetch("/api/path", {
+      const response = await fetch("/api/path/stream", {
         method: "POST",
         headers: { "Content-Type": "application/json" },
         body: JSON.stringify({
@@ -101,21 +105,70 @@ export default function Home() {
         }),
       });
       
-      if (!response.ok) {
+      if (!response.ok || !response.body) {
         throw new Error(`HTTP error! status: ${response.status}`);
       }
   
-      const result = await response.json();
-      const sanitizedResult = JSON.parse(
-        JSON.stringify(result).replace(/"\s*:\s*inf/g, ': null')
-      );
-      
-      setPathResult(sanitizedResult);
-      setCurrentStepIndex(0);
-      setIsAnimating(true);
+      // The backend sends one JSON message per line: every step as it is
+      // produced, then the final path
+      setIsStreaming(true);
+      const reader = response.body.getReader();
+      const decoder = new TextDecoder();
+      let buffered = "";
+      let started = false;
+      let lastStep: AlgorithmStep | null = null;
+      while (true) {
+        const { done, value } = await reader.read();
+        if (done) break;
+        buffered += decoder.decode(value, { stream: true });
+        const lines = buffered.split("\n");
+        buffered = lines.pop() ?? "";
+  
+        const steps: AlgorithmStep[] = [];
+        let final: { path: string[]; totalDistance: number; approximate?: boolean } | null = null;
+        for (const line of lines) {
+          if (!line.trim()) continue;
+          const message = JSON.parse(line);
+          if (message.type === "step") {
+            // Steps arrive as changes against the previous one
+            const delta = message.step;
+            lastStep = {
+              currentNode: delta.currentNode,
+              frontier: delta.frontier,
+              visitedNodes: [...(lastStep?.visitedNodes ?? []), ...delta.visitedNodes],
+              distances: { ...(lastStep?.distances ?? {}), ...delta.distances },
+              previousNodes: { ...(lastStep?.previousNodes ?? {}), ...delta.previousNodes },
+            };
+            steps.push(lastStep);
+          } else if (message.type === "result") {
+            final = message;
+          } else if (message.type === "error") {
+            throw new Error(message.error);
+          }
+        }
+  
+        if (steps.length === 0 && !final) continue;
+        setPathResult((prev) => {
+          const merged = [...(prev?.steps ?? []), ...steps];
+          // The final message applies even without steps (e.g. no route found)
+          if (merged.length === 0 && !final) return prev;
+          return {
+            path: final ? final.path : prev?.path ?? [],
+            totalDistance: final ? final.totalDistance : prev?.totalDistance ?? 0,
+            steps: merged,
+            approximate: final ? final.approximate : prev?.approximate,
+          };
+        });
+        if (!started && steps.length > 0) {
+          started = true;
+          setCurrentStepIndex(0);
+          setIsAnimating(true);
+        }
+      }
     } catch (error) {
       toast.error(error instanceof Error ? error.message : "Failed to calculate route");
     } finally {
+      setIsStreaming(false);
       setIsLoading(false);
     }
   };
@@ -128,31 +181,29 @@ export default function Home() {
     setIsAnimating(false);
   };
 
-  const animateAlgorithm = useCallback(() => {
-    if (!pathResult || currentStepIndex >= pathResult.steps.length - 1) {
-      setIsAnimating(false);
-      return;
-    }
+  // The interval reads these through refs so that steps arriving from a
+  // stream don't restart it
+  const stepIndexRef = useRef(0);
+  const stepCountRef = useRef(0);
+  const isStreamingRef = useRef(false);
+  stepIndexRef.current = currentStepIndex;
+  stepCountRef.current = pathResult?.steps.length ?? 0;
+  isStreamingRef.current = isStreaming;
+
+  useEffect(() => {
+    if (!isAnimating) return;
 
     const interval = setInterval(() => {
-      setCurrentStepIndex((prev) => {
-        if (prev >= pathResult.steps.length - 1) {
-          clearInterval(interval);
-          setIsAnimating(false);
-          return prev;
-        }
-        return prev + 1;
-      });
+      if (stepIndexRef.current < stepCountRef.current - 1) {
+        setCurrentStepIndex(stepIndexRef.current + 1);
+      } else if (!isStreamingRef.current) {
+        // Only stop at the last step once the stream has finished
+        setIsAnimating(false);
+      }
     }, 1000);
 
     return () => clearInterval(interval);
-  }, [pathResult, currentStepIndex]);
-
-  useEffect(() => {
-    if (isAnimating) {
-      animateAlgorithm();
-    }
-  }, [isAnimating, animateAlgorithm]);
+  }, [isAnimating]);
 
   return (
     <main className="min-h-screen bg-gray-100 dark:bg-gray-900">
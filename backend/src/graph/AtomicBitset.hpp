@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Fixed-size bitset whose words can be updated from several threads at once.
+// Used for BFS frontiers and visited sets, one bit per node index.
+class AtomicBitset {
+public:
+    explicit AtomicBitset(size_t bits)
+        : bitCount(bits), wordCount((bits + 63) / 64),
+          words(new std::atomic<uint64_t>[wordCount]) {
+        clearWords(0, wordCount);
+    }
+    
+    size_t size() const { return bitCount; }
+    size_t numWords() const { return wordCount; }
+    
+    bool test(size_t bit) const {
+        return (words[bit >> 6].load(std::memory_order_relaxed) >> (bit & 63)) & 1;
+    }
+    
+    // Set a bit; returns true if this call changed it from 0 to 1
+    bool set(size_t bit) {
+        uint64_t mask = uint64_t(1) << (bit & 63);
+        return !(words[bit >> 6].fetch_or(mask, std::memory_order_relaxed) & mask);
+    }
+    
+    uint64_t word(size_t index) const { return words[index].load(std::memory_order_relaxed); }
+    void setWord(size_t index, uint64_t bits) { words[index].store(bits, std::memory_order_relaxed); }
+    // Read a word and clear it
+    uint64_t takeWord(size_t index) { return words[index].exchange(0, std::memory_order_relaxed); }
+    
+    // Mask of the bits in a word that correspond to real indices
+    uint64_t validMask(size_t index) const {
+        size_t tail = bitCount - index * 64;
+        return tail >= 64 ? ~uint64_t(0) : (uint64_t(1) << tail) - 1;
+    }
+    
+    void clearWords(size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            words[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    size_t bitCount;
+    size_t wordCount;
+    std::unique_ptr<std::atomic<uint64_t>[]> words;
+};
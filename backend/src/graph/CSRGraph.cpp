@@ -1,81 +1,144 @@
 // CSRGraph.cpp
 #include "CSRGraph.hpp"
-#include <queue>
+#include "AtomicBitset.hpp"
+#include "../utils/Trace.hpp"
+#include "../utils/WorkerPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <limits>
-#include <unordered_set>
 
-web::json::value CSRGraph::AlgorithmStep::toJson() const {
-    web::json::value json;
-    json[U("currentNode")] = web::json::value::string(utility::conversions::to_string_t(currentNode));
+void CSRGraph::AlgorithmStep::writeJson(JsonWriter& writer) const {
+    writer.beginObject();
+    writer.key("currentNode").value(currentNode);
     
-    web::json::value visitedJson = web::json::value::array();
-    for (size_t i = 0; i < visitedNodes.size(); ++i) {
-        visitedJson[i] = web::json::value::string(utility::conversions::to_string_t(visitedNodes[i]));
+    writer.key("visitedNodes").beginArray();
+    for (const auto& id : visitedNodes) {
+        writer.value(id);
     }
-    json[U("visitedNodes")] = visitedJson;
+    writer.endArray();
     
-    web::json::value frontierJson = web::json::value::array();
-    for (size_t i = 0; i < frontier.size(); ++i) {
-        frontierJson[i] = web::json::value::string(utility::conversions::to_string_t(frontier[i]));
+    writer.key("frontier").beginArray();
+    for (const auto& id : frontier) {
+        writer.value(id);
     }
-    json[U("frontier")] = frontierJson;
+    writer.endArray();
     
-    web::json::value distancesJson = web::json::value::object();
+    writer.key("distances").beginObject();
     for (const auto& pair : distances) {
-      if (pair.second == std::numeric_limits<double>::infinity()) {
-        distancesJson[utility::conversions::to_string_t(pair.first)] = web::json::value::string(U("∞"));
-      } else {
-       distancesJson[utility::conversions::to_string_t(pair.first)] = json::value::number(pair.second);
-      }
-    } 
-    json[U("distances")] = distancesJson;
-    
-    web::json::value previousJson = web::json::value::object();
+        writer.key(pair.first);
+        if (pair.second == std::numeric_limits<double>::infinity()) {
+            writer.value("∞");
+        } else {
+            writer.value(pair.second);
+        }
+    }
+    writer.endObject();
+    
+    writer.key("previousNodes").beginObject();
     for (const auto& pair : previousNodes) {
-        previousJson[utility::conversions::to_string_t(pair.first)] = 
-            web::json::value::string(utility::conversions::to_string_t(pair.second));
+        writer.key(pair.first).value(pair.second);
     }
-    json[U("previousNodes")] = previousJson;
+    writer.endObject();
     
-    return json;
+    writer.endObject();
 }
 
-web::json::value CSRGraph::PathResult::toJson() const {
-    web::json::value json;
-    
-    web::json::value pathJson = web::json::value::array();
-    for (size_t i = 0; i < path.size(); ++i) {
-        pathJson[i] = web::json::value::string(utility::conversions::to_string_t(path[i]));
+void CSRGraph::PathResult::writeJson(JsonWriter& writer) const {
+    writer.beginObject();
+    writeJsonFields(writer);
+    writer.endObject();
+}
+
+void CSRGraph::PathResult::writeJsonFields(JsonWriter& writer, bool includeSteps) const {
+    writer.key("path").beginArray();
+    for (const auto& id : path) {
+        writer.value(id);
     }
-    json[U("path")] = pathJson;
-    
-    json[U("totalDistance")] = totalDistance;
+    writer.endArray();
     
-    web::json::value stepsJson = web::json::value::array();
-    for (size_t i = 0; i < steps.size(); ++i) {
-        stepsJson[i] = steps[i].toJson();
+    writer.key("totalDistance").value(totalDistance);
+    if (approximate) {
+        writer.key("approximate").value(true);
     }
-    json[U("steps")] = stepsJson;
     
-    return json;
+    if (includeSteps) {
+        writer.key("steps").beginArray();
+        for (const auto& step : steps) {
+            step.writeJson(writer);
+        }
+        writer.endArray();
+    }
+}
+
+void CSRGraph::emitStep(const Snapshot& graph, SearchWorkspace& workspace, int current, int target,
+                        bool hopCounts, PathResult& result, const StepCallback& onStep) {
+    if (onStep) {
+        onStep(recordStep(graph, workspace, current, target, hopCounts, true));
+    } else {
+        result.steps.push_back(recordStep(graph, workspace, current, target, hopCounts, false));
+    }
+}
+
+namespace {
+
+// Overlay sizes past which an edit triggers compaction back into CSR arrays
+constexpr size_t COMPACT_TEMPORARY_NODES = 64;
+constexpr size_t COMPACT_EXTRA_EDGES = 8192;
+constexpr size_t COMPACT_MASKED_EDGES = 65536;
+
+} // namespace
+
+CSRGraph::CSRGraph() : topology(std::make_shared<Topology>()) {
+    publish(topology, std::make_shared<GraphOverlay>());
+}
+
+int CSRGraph::Snapshot::indexOf(const std::string& id) const {
+    auto it = csr->nodeIndices.find(id);
+    if (it != csr->nodeIndices.end()) {
+        return it->second;
+    }
+    auto temp = overlay->temporaryIndices.find(id);
+    return temp != overlay->temporaryIndices.end() ? temp->second : -1;
+}
+
+size_t CSRGraph::Snapshot::degree(int index) const {
+    size_t count = 0;
+    if (static_cast<size_t>(index) < csr->nodes.size()) {
+        count = csr->rowPtr[index + 1] - csr->rowPtr[index];
+    }
+    if (const auto* extra = overlay->edgesFrom(index)) {
+        count += extra->size();
+    }
+    return count;
+}
+
+void CSRGraph::publish(std::shared_ptr<const Topology> csr, std::shared_ptr<const GraphOverlay> overlay) {
+    auto next = std::make_shared<Snapshot>();
+    next->csr = std::move(csr);
+    next->overlay = std::move(overlay);
+    std::atomic_store(&current, std::shared_ptr<const Snapshot>(std::move(next)));
 }
 
 void CSRGraph::addNode(std::shared_ptr<Node> node) {
-    nodeIndices[node->getId()] = nodes.size();
-    nodes.push_back(node);
-    rowPtr.push_back(colIdx.size());
+    topology->nodeIndices[node->getId()] = topology->nodes.size();
+    topology->nodes.push_back(node);
+    topology->rowPtr.push_back(topology->colIdx.size());
 }
 
 void CSRGraph::addEdge(int from, int to, double weight) {
-    colIdx.push_back(to);
-    values.push_back(weight);
+    topology->colIdx.push_back(to);
+    topology->values.push_back(weight);
 }
 
 void CSRGraph::connectNodesWithinRange(double maxDistance) {
-    rowPtr.clear();
-    colIdx.clear();
-    values.clear();
-    rowPtr.push_back(0);
+    connectRange = maxDistance;
+    
+    auto& nodes = topology->nodes;
+    topology->rowPtr.clear();
+    topology->colIdx.clear();
+    topology->values.clear();
+    topology->rowPtr.push_back(0);
     
     for (size_t i = 0; i < nodes.size(); ++i) {
         for (size_t j = 0; j < nodes.size(); ++j) {
@@ -86,221 +149,723 @@ void CSRGraph::connectNodesWithinRange(double maxDistance) {
                 }
             }
         }
-        rowPtr.push_back(colIdx.size());
+        topology->rowPtr.push_back(topology->colIdx.size());
     }
 }
 
-web::json::value CSRGraph::getGraphVisualizationData() const {
-    web::json::value json;
+bool CSRGraph::disableNode(const std::string& id) {
+    std::lock_guard<std::mutex> lock(editMutex);
+    auto graph = snapshot();
+    int index = graph->indexOf(id);
+    if (index < 0) {
+        return false;
+    }
     
-    // Add nodes
-    web::json::value nodesJson = web::json::value::array();
-    for (size_t i = 0; i < nodes.size(); ++i) {
-        nodesJson[i] = nodes[i]->toJson();
+    auto overlay = std::make_shared<GraphOverlay>(*graph->overlay);
+    if (GraphOverlay::setBit(overlay->disabledNodes, index, true)) {
+        ++overlay->disabledCount;
+    }
+    publish(graph->csr, overlay);
+    return true;
+}
+
+bool CSRGraph::enableNode(const std::string& id) {
+    std::lock_guard<std::mutex> lock(editMutex);
+    auto graph = snapshot();
+    int index = graph->indexOf(id);
+    if (index < 0) {
+        return false;
     }
-    json[U("nodes")] = nodesJson;
     
-    // Add edges
-    web::json::value edgesJson = web::json::value::array();
-    int edgeIndex = 0;
-    for (size_t i = 0; i < nodes.size(); ++i) {
-        for (int j = rowPtr[i]; j < rowPtr[i + 1]; ++j) {
-            web::json::value edge;
-            edge[U("from")] = web::json::value::string(utility::conversions::to_string_t(nodes[i]->getId()));
-            edge[U("to")] = web::json::value::string(utility::conversions::to_string_t(nodes[colIdx[j]]->getId()));
-            edge[U("distance")] = values[j];
-            edgesJson[edgeIndex++] = edge;
+    auto overlay = std::make_shared<GraphOverlay>(*graph->overlay);
+    if (GraphOverlay::setBit(overlay->disabledNodes, index, false)) {
+        --overlay->disabledCount;
+    }
+    publish(graph->csr, overlay);
+    return true;
+}
+
+bool CSRGraph::addTemporaryWaypoint(std::shared_ptr<Waypoint> waypoint) {
+    std::lock_guard<std::mutex> lock(editMutex);
+    auto graph = snapshot();
+    if (graph->indexOf(waypoint->getId()) >= 0) {
+        return false;
+    }
+    
+    auto overlay = std::make_shared<GraphOverlay>(*graph->overlay);
+    int index = static_cast<int>(graph->nodeCount());
+    overlay->temporaryIndices[waypoint->getId()] = index;
+    overlay->temporaryNodes.push_back(waypoint);
+    
+    // Edges go both ways so the graph stays symmetric for bottom-up BFS
+    Coordinates coords = waypoint->getCoordinates();
+    for (int other = 0; other < index; ++other) {
+        Coordinates otherCoords = graph->node(other)->getCoordinates();
+        double distance = coords.distanceTo(otherCoords);
+        if (distance <= connectRange && !overlay->isClosed(coords, otherCoords)) {
+            overlay->extraEdges[index].push_back({other, distance});
+            overlay->extraEdges[other].push_back({index, distance});
+            overlay->extraEdgeCount += 2;
         }
     }
-    json[U("edges")] = edgesJson;
     
-    return json;
+    publish(graph->csr, overlay);
+    compactIfNeeded();
+    return true;
 }
 
-bool isAirport(const std::string& id) {
-    // For Moroccan airports
-    if (id.length() == 4 && id.substr(0, 2) == "GM") {
-        return true;
+size_t CSRGraph::closeAirspace(const std::vector<Coordinates>& polygon) {
+    std::lock_guard<std::mutex> lock(editMutex);
+    auto graph = snapshot();
+    auto overlay = std::make_shared<GraphOverlay>(*graph->overlay);
+    const Topology& csr = *graph->csr;
+    size_t closed = 0;
+    
+    GraphOverlay::ClosedArea area(polygon);
+    
+    for (size_t i = 0; i < csr.nodes.size(); ++i) {
+        Coordinates from = csr.nodes[i]->getCoordinates();
+        for (int j = csr.rowPtr[i]; j < csr.rowPtr[i + 1]; ++j) {
+            if (overlay->isEdgeMasked(j)) continue;
+            if (area.touches(from, csr.nodes[csr.colIdx[j]]->getCoordinates())) {
+                GraphOverlay::setBit(overlay->maskedEdges, j, true);
+                ++overlay->maskedCount;
+                ++closed;
+            }
+        }
+    }
+    
+    // Extra edges are few, so closing them just removes them
+    for (auto& entry : overlay->extraEdges) {
+        Coordinates from = graph->node(entry.first)->getCoordinates();
+        auto& edges = entry.second;
+        size_t before = edges.size();
+        edges.erase(std::remove_if(edges.begin(), edges.end(), [&](const GraphOverlay::Edge& edge) {
+            return area.touches(from, graph->node(edge.first)->getCoordinates());
+        }), edges.end());
+        closed += before - edges.size();
+        overlay->extraEdgeCount -= before - edges.size();
     }
-    return false;
+    
+    overlay->closedAreas.push_back(std::move(area));
+    publish(graph->csr, overlay);
+    compactIfNeeded();
+    return closed;
 }
 
-// Implementation of Dijkstra's algorithm with step tracking
-CSRGraph::PathResult CSRGraph::findPathDijkstra(const std::string& start, const std::string& end) {
-    PathResult result;
-    std::unordered_map<std::string, double> distances;
-    std::unordered_map<std::string, std::string> previous;
-    std::unordered_set<std::string> visited;
+void CSRGraph::compact() {
+    std::lock_guard<std::mutex> lock(editMutex);
+    compactLocked();
+}
 
-    if (!isAirport(start) || !isAirport(end)) {
-        return result;
+void CSRGraph::compactIfNeeded() {
+    auto overlay = snapshot()->overlay;
+    if (overlay->temporaryNodes.size() > COMPACT_TEMPORARY_NODES ||
+        overlay->extraEdgeCount > COMPACT_EXTRA_EDGES ||
+        overlay->maskedCount > COMPACT_MASKED_EDGES) {
+        compactLocked();
     }
+}
 
+void CSRGraph::compactLocked() {
+    ScopedTimer timer("compact");
+    auto graph = snapshot();
+    const Topology& old = *graph->csr;
+    const GraphOverlay& edits = *graph->overlay;
+    size_t nodeCount = graph->nodeCount();
+    
+    // Temporary nodes keep their indices, so the disabled bits carry over as-is
+    auto csr = std::make_shared<Topology>();
+    csr->nodes.reserve(nodeCount);
+    csr->rowPtr.reserve(nodeCount + 1);
+    csr->colIdx.reserve(old.colIdx.size() - edits.maskedCount + edits.extraEdgeCount);
+    csr->values.reserve(csr->colIdx.capacity());
+    csr->rowPtr.push_back(0);
     
-    // Initialize distances
-    for (const auto& node : nodes) {
-        distances[node->getId()] = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < nodeCount; ++i) {
+        const auto& node = graph->node(i);
+        csr->nodeIndices[node->getId()] = i;
+        csr->nodes.push_back(node);
+        
+        // Edges to disabled nodes stay, so re-enabling them later still works
+        if (i < old.nodes.size()) {
+            for (int j = old.rowPtr[i]; j < old.rowPtr[i + 1]; ++j) {
+                if (edits.isEdgeMasked(j)) continue;
+                csr->colIdx.push_back(old.colIdx[j]);
+                csr->values.push_back(old.values[j]);
+            }
+        }
+        if (const auto* extra = edits.edgesFrom(i)) {
+            for (const auto& edge : *extra) {
+                csr->colIdx.push_back(edge.first);
+                csr->values.push_back(edge.second);
+            }
+        }
+        csr->rowPtr.push_back(csr->colIdx.size());
     }
-    distances[start] = 0;
     
-    // Priority queue for Dijkstra's algorithm
-    auto compare = [](const std::pair<std::string, double>& a, const std::pair<std::string, double>& b) {
-        return a.second > b.second;
-    };
-    std::priority_queue<std::pair<std::string, double>, 
-                       std::vector<std::pair<std::string, double>>,
-                       decltype(compare)> pq(compare);
+    auto overlay = std::make_shared<GraphOverlay>();
+    overlay->disabledNodes = edits.disabledNodes;
+    overlay->disabledCount = edits.disabledCount;
+    overlay->closedAreas = edits.closedAreas;
     
-    pq.push({start, 0});
+    topology = csr;
+    publish(csr, overlay);
+}
+
+CSRGraph::EditStats CSRGraph::getEditStats() const {
+    auto overlay = snapshot()->overlay;
+    EditStats stats;
+    stats.disabledNodes = overlay->disabledCount;
+    stats.temporaryNodes = overlay->temporaryNodes.size();
+    stats.maskedEdges = overlay->maskedCount;
+    stats.extraEdges = overlay->extraEdgeCount;
+    return stats;
+}
 
+void CSRGraph::writeVisualizationNodes(JsonWriter& writer) const {
+    auto graph = snapshot();
+    size_t nodeCount = graph->nodeCount();
     
-    while (!pq.empty()) {
+    // Disabled nodes are left out along with their edges
+    for (size_t i = 0; i < nodeCount; ++i) {
+        if (graph->isDisabled(i)) continue;
+        graph->node(i)->writeJson(writer);
+    }
+}
 
-        std::string current = pq.top().first;
-        pq.pop();
-        
-        if (visited.count(current)) continue;
-        visited.insert(current);
+void CSRGraph::writeVisualizationEdges(JsonWriter& writer) const {
+    auto graph = snapshot();
+    size_t nodeCount = graph->nodeCount();
+    
+    // Edges straight from the CSR arrays and overlay
+    for (size_t i = 0; i < nodeCount; ++i) {
+        if (graph->isDisabled(i)) continue;
+        const std::string& fromId = graph->node(i)->getId();
+        graph->forEachNeighbor(i, [&](int neighbor, double distance) {
+            writer.beginObject();
+            writer.key("from").value(fromId);
+            writer.key("to").value(graph->node(neighbor)->getId());
+            writer.key("distance").value(distance);
+            writer.endObject();
+        });
+    }
+}
+
+namespace {
+
+bool isAirport(const Node& node) {
+    return node.getType() == Node::Type::AIRPORT;
+}
+
+} // namespace
+
+// Hands a pooled workspace to one search and returns it to the pool afterwards
+class CSRGraph::WorkspaceLease {
+public:
+    WorkspaceLease(const CSRGraph& graph, size_t nodeCount)
+        : graph(graph), workspace(graph.acquireWorkspace()) {
+        workspace->reset(nodeCount);
+    }
+    ~WorkspaceLease() { graph.releaseWorkspace(std::move(workspace)); }
+    
+    SearchWorkspace& operator*() const { return *workspace; }
+
+private:
+    const CSRGraph& graph;
+    std::unique_ptr<SearchWorkspace> workspace;
+};
+
+std::unique_ptr<SearchWorkspace> CSRGraph::acquireWorkspace() const {
+    std::lock_guard<std::mutex> lock(workspaceMutex);
+    if (workspacePool.empty()) {
+        return std::make_unique<SearchWorkspace>();
+    }
+    auto workspace = std::move(workspacePool.back());
+    workspacePool.pop_back();
+    return workspace;
+}
+
+void CSRGraph::releaseWorkspace(std::unique_ptr<SearchWorkspace> workspace) const {
+    std::lock_guard<std::mutex> lock(workspaceMutex);
+    workspacePool.push_back(std::move(workspace));
+}
+
+bool CSRGraph::canTraverse(const Snapshot& graph, int node, int target) {
+    // Airports may only appear as the destination, never as an intermediate hop
+    return node == target || !isAirport(*graph.node(node));
+}
+
+CSRGraph::AlgorithmStep CSRGraph::recordStep(const Snapshot& graph, SearchWorkspace& workspace,
+                                             int current, int target, bool hopCounts, bool delta) {
+    ScopedTimer timer("steps");
+    AlgorithmStep step;
+    step.currentNode = graph.node(current)->getId();
+    
+    // A delta covers only the nodes relaxed since the previous step. BFS
+    // marks nodes visited as it relaxes them; Dijkstra visits just current.
+    if (!delta) {
+        step.visitedNodes.reserve(workspace.visitedOrder().size());
+        for (int node : workspace.visitedOrder()) {
+            step.visitedNodes.push_back(graph.node(node)->getId());
+        }
+    } else if (hopCounts) {
+        for (int node : workspace.changed) {
+            step.visitedNodes.push_back(graph.node(node)->getId());
+        }
+    } else {
+        step.visitedNodes.push_back(step.currentNode);
+    }
+    
+    // Only nodes the search has reached are listed; all others are at infinity
+    for (int node : delta ? workspace.changed : workspace.reachedOrder()) {
+        const std::string& id = graph.node(node)->getId();
+        if (hopCounts) {
+            step.distances[id] = 1.0;
+        } else {
+            step.distances[id] = workspace.distance(node);
+        }
+        int previous = workspace.previous(node);
+        if (previous >= 0) {
+            step.previousNodes[id] = graph.node(previous)->getId();
+        }
+    }
+    
+    graph.forEachNeighbor(current, [&](int neighbor, double) {
+        if (canTraverse(graph, neighbor, target) && !workspace.isVisited(neighbor)) {
+            step.frontier.push_back(graph.node(neighbor)->getId());
+        }
+    });
+    
+    if (delta) {
+        workspace.changed.clear();
+    }
+    return step;
+}
+
+void CSRGraph::reconstructPath(const Snapshot& graph, const SearchWorkspace& workspace,
+                               int start, int end, PathResult& result) {
+    for (int current = end; current != start; current = workspace.previous(current)) {
+        result.path.push_back(graph.node(current)->getId());
+    }
+    result.path.push_back(graph.node(start)->getId());
+    std::reverse(result.path.begin(), result.path.end());
+    result.totalDistance = workspace.distance(end);
+}
+
+// Dijkstra over one snapshot; stops once target is settled, or explores
+// everything reachable when target is -1. A sorted settle list stops it as
+// soon as all of those nodes are settled instead. Steps are recorded only
+// when a result to record them into is given.
+void CSRGraph::runDijkstra(const Snapshot& graph, SearchWorkspace& workspace, int source, int target,
+                           PathResult* steps, const StepCallback& onStep, const std::vector<int>* settle) {
+    // Min-heap on distance, kept in the workspace's reusable storage
+    auto& heap = workspace.heap;
+    auto compare = std::greater<std::pair<double, int>>();
+    size_t unsettled = settle ? settle->size() : 0;
+    bool streaming = steps && onStep;
+    
+    workspace.relax(source, 0, -1);
+    heap.push_back({0, source});
+    if (streaming) workspace.changed.push_back(source);
+    
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), compare);
+        int current = heap.back().second;
+        heap.pop_back();
         
-        AlgorithmStep step;
-        step.currentNode = current;
-        step.visitedNodes = std::vector<std::string>(visited.begin(), visited.end());
-        step.distances = distances;
-        step.previousNodes = previous;
+        if (workspace.isVisited(current)) continue;
+        workspace.markVisited(current);
         
-        // Get frontier nodes
-        std::vector<std::string> frontier;
-        int nodeIdx = nodeIndices[current];
-        for (int i = rowPtr[nodeIdx]; i < rowPtr[nodeIdx + 1]; ++i) {
-            std::string neighborId = nodes[colIdx[i]]->getId();
-            if (isAirport(neighborId) && neighborId != end) continue;
-            if (!visited.count(neighborId)) {
-                frontier.push_back(neighborId);
-            }
+        if (steps) {
+            emitStep(graph, workspace, current, target, false, *steps, onStep);
         }
-        step.frontier = frontier;
-        result.steps.push_back(step);
         
-        if (current == end) break;
+        if (current == target) break;
+        if (settle && std::binary_search(settle->begin(), settle->end(), current) && --unsettled == 0) break;
         
         // Process neighbors
-        nodeIdx = nodeIndices[current];
-        for (int i = rowPtr[nodeIdx]; i < rowPtr[nodeIdx + 1]; ++i) {
-            std::string neighborId = nodes[colIdx[i]]->getId();
-            if (isAirport(neighborId) && neighborId != end) continue;
-            double distance = distances[current] + values[i];
+        double currentDistance = workspace.distance(current);
+        graph.forEachNeighbor(current, [&](int neighbor, double weight) {
+            if (!canTraverse(graph, neighbor, target)) return;
+            double distance = currentDistance + weight;
             
-            if (distance < distances[neighborId]) {
-                distances[neighborId] = distance;
-                previous[neighborId] = current;
-                pq.push({neighborId, distance});
+            if (distance < workspace.distance(neighbor)) {
+                workspace.relax(neighbor, distance, current);
+                heap.push_back({distance, neighbor});
+                std::push_heap(heap.begin(), heap.end(), compare);
+                if (streaming) workspace.changed.push_back(neighbor);
             }
-        }
+        });
+    }
+}
+
+// Implementation of Dijkstra's algorithm with step tracking
+CSRGraph::PathResult CSRGraph::findPathDijkstra(const std::string& start, const std::string& end,
+                                                const StepCallback& onStep) const {
+    ScopedTimer timer("search");
+    PathResult result;
+    auto graph = snapshot();
+    int source = graph->indexOf(start);
+    int target = graph->indexOf(end);
+    if (source < 0 || target < 0 || graph->isDisabled(source)) {
+        return result;
     }
     
-    // Reconstruct path
-    if (distances[end] != std::numeric_limits<double>::infinity()) {
-        std::string current = end;
-        while (current != start) {
-            result.path.push_back(current);
-            current = previous[current];
-        }
-        result.path.push_back(start);
-        std::reverse(result.path.begin(), result.path.end());
-        result.totalDistance = distances[end];
+    // Routes run from airport to airport
+    if (!isAirport(*graph->node(source)) || !isAirport(*graph->node(target))) {
+        return result;
+    }
+    
+    WorkspaceLease lease(*this, graph->nodeCount());
+    SearchWorkspace& workspace = *lease;
+    runDijkstra(*graph, workspace, source, target, &result, onStep);
+    
+    if (workspace.reached(target)) {
+        reconstructPath(*graph, workspace, source, target, result);
     }
     
     return result;
 }
 
-// Implementation of BFS with step tracking
-CSRGraph::PathResult CSRGraph::findPathBFS(const std::string& start, const std::string& end) {
+CSRGraph::PathResult CSRGraph::findShortestPath(const std::string& start, const std::string& end) const {
     PathResult result;
-    std::unordered_map<std::string, std::string> previous;
-    std::unordered_set<std::string> visited;
-    std::queue<std::string> queue;
+    auto graph = snapshot();
+    int source = graph->indexOf(start);
+    int target = graph->indexOf(end);
+    if (source < 0 || target < 0 || graph->isDisabled(source)) {
+        return result;
+    }
     
-    queue.push(start);
-    visited.insert(start);
+    WorkspaceLease lease(*this, graph->nodeCount());
+    SearchWorkspace& workspace = *lease;
+    runDijkstra(*graph, workspace, source, target, nullptr, nullptr);
     
-    while (!queue.empty()) {
-        std::string current = queue.front();
-        queue.pop();
-        
-        // Create algorithm step
-        AlgorithmStep step;
-        step.currentNode = current;
-        step.visitedNodes = std::vector<std::string>(visited.begin(), visited.end());
-        step.previousNodes = previous;
-        
-        // Get frontier nodes
-        std::vector<std::string> frontier;
-        int nodeIdx = nodeIndices[current];
-        for (int i = rowPtr[nodeIdx]; i < rowPtr[nodeIdx + 1]; ++i) {
-            std::string neighborId = nodes[colIdx[i]]->getId();
-            if (isAirport(neighborId) && neighborId != end) continue;
-            if (!visited.count(neighborId)) {
-                frontier.push_back(neighborId);
-            }
+    if (workspace.reached(target)) {
+        reconstructPath(*graph, workspace, source, target, result);
+    }
+    
+    return result;
+}
+
+std::vector<double> CSRGraph::shortestDistances(const std::string& start,
+                                                const std::vector<std::string>& targets) const {
+    std::vector<double> distances(targets.size(), SearchWorkspace::INF);
+    auto graph = snapshot();
+    int source = graph->indexOf(start);
+    if (source < 0 || graph->isDisabled(source)) {
+        return distances;
+    }
+    
+    // Stop once every target the search can settle has been; airports other
+    // than the source are never expanded, so they are not waited for
+    std::vector<int> settle;
+    for (const auto& id : targets) {
+        int target = graph->indexOf(id);
+        if (target >= 0 && !graph->isDisabled(target) && canTraverse(*graph, target, source)) {
+            settle.push_back(target);
         }
-        step.frontier = frontier;
-        
-        // Add distances for visualization (even though BFS doesn't use them)
-        std::unordered_map<std::string, double> distances;
-        for (const auto& node : nodes) {
-            distances[node->getId()] = visited.count(node->getId()) ? 1.0 : std::numeric_limits<double>::infinity();
+    }
+    std::sort(settle.begin(), settle.end());
+    settle.erase(std::unique(settle.begin(), settle.end()), settle.end());
+    if (settle.empty()) {
+        return distances;
+    }
+    
+    WorkspaceLease lease(*this, graph->nodeCount());
+    SearchWorkspace& workspace = *lease;
+    runDijkstra(*graph, workspace, source, -1, nullptr, nullptr, &settle);
+    
+    for (size_t i = 0; i < targets.size(); ++i) {
+        int target = graph->indexOf(targets[i]);
+        if (target >= 0) {
+            distances[i] = workspace.distance(target);
         }
-        step.distances = distances;
+    }
+    return distances;
+}
+
+// Implementation of BFS with step tracking
+CSRGraph::PathResult CSRGraph::findPathBFS(const std::string& start, const std::string& end,
+                                           const StepCallback& onStep) const {
+    ScopedTimer timer("search");
+    PathResult result;
+    auto graph = snapshot();
+    int source = graph->indexOf(start);
+    int target = graph->indexOf(end);
+    if (source < 0 || target < 0 || graph->isDisabled(source)) {
+        return result;
+    }
+    
+    WorkspaceLease lease(*this, graph->nodeCount());
+    SearchWorkspace& workspace = *lease;
+    
+    // FIFO over the workspace's reusable storage; head marks the front
+    auto& queue = workspace.queue;
+    size_t head = 0;
+    
+    // In BFS "visited" means discovered, so nodes are marked when enqueued.
+    // Distances accumulate edge lengths so the path length falls out directly.
+    workspace.relax(source, 0, -1);
+    workspace.markVisited(source);
+    queue.push_back(source);
+    if (onStep) workspace.changed.push_back(source);
+    
+    while (head < queue.size()) {
+        int current = queue[head++];
         
-        result.steps.push_back(step);
+        emitStep(*graph, workspace, current, target, true, result, onStep);
         
-        if (current == end) break;
+        if (current == target) break;
         
         // Process neighbors
-        nodeIdx = nodeIndices[current];
-        for (int i = rowPtr[nodeIdx]; i < rowPtr[nodeIdx + 1]; ++i) {
-            std::string neighborId = nodes[colIdx[i]]->getId();
-            if (isAirport(neighborId) && neighborId != end) continue;
-            if (!visited.count(neighborId)) {
-                visited.insert(neighborId);
-                previous[neighborId] = current;
-                queue.push(neighborId);
+        double currentDistance = workspace.distance(current);
+        graph->forEachNeighbor(current, [&](int neighbor, double weight) {
+            if (!canTraverse(*graph, neighbor, target)) return;
+            if (!workspace.isVisited(neighbor)) {
+                workspace.markVisited(neighbor);
+                workspace.relax(neighbor, currentDistance + weight, current);
+                queue.push_back(neighbor);
+                if (onStep) workspace.changed.push_back(neighbor);
             }
-        }
+        });
     }
     
-    // Reconstruct path
-    if (visited.count(end)) {
-        std::string current = end;
-        double totalDistance = 0;
-        
-        while (current != start) {
-            result.path.push_back(current);
-            std::string prev = previous[current];
-            
-            // Calculate actual distance for this edge
-            int nodeIdx = nodeIndices[prev];
-            for (int i = rowPtr[nodeIdx]; i < rowPtr[nodeIdx + 1]; ++i) {
-                if (nodes[colIdx[i]]->getId() == current) {
-                    totalDistance += values[i];
-                    break;
+    if (workspace.isVisited(target)) {
+        reconstructPath(*graph, workspace, source, target, result);
+    }
+    
+    return result;
+}
+
+namespace {
+
+// Tuning for the direction switch (Beamer et al.): go bottom-up once the
+// frontier's edges exceed 1/ALPHA of the unexplored edges, and back to
+// top-down once the frontier holds fewer than 1/BETA of all nodes.
+constexpr double BFS_ALPHA = 14.0;
+constexpr double BFS_BETA = 24.0;
+
+// Smallest range of bitset words handed to a pool worker. A level scans each
+// node's edges, dozens at the 100 nm link range, so 16 words (1024 nodes) are
+// tens of microseconds of work against a few for the handoff, and regions of
+// a few thousand nodes still split across cores.
+constexpr size_t BFS_WORDS_PER_THREAD = 16;
+
+} // namespace
+
+// Level-synchronous BFS over node indices that switches between top-down and
+// bottom-up expansion depending on frontier size. Bottom-up scans a node's
+// own edge list for frontier parents, which relies on the graph being
+// symmetric: connectNodesWithinRange, temporary waypoints and airspace
+// closures all keep it that way.
+CSRGraph::HopSearch::HopSearch(const CSRGraph& owner)
+    : graph(owner.snapshot()), visited(graph->nodeCount()), frontier(graph->nodeCount()),
+      next(graph->nodeCount()),
+      unexploredEdges(static_cast<double>(graph->csr->colIdx.size() - graph->overlay->maskedCount +
+                                          graph->overlay->extraEdgeCount)) {
+    // Disabled nodes start out visited so neither direction ever reaches them
+    const auto& disabled = graph->overlay->disabledNodes;
+    for (size_t w = 0; w < std::min(visited.numWords(), disabled.size()); ++w) {
+        visited.setWord(w, disabled[w]);
+    }
+}
+
+size_t CSRGraph::HopSearch::totalNodes() const {
+    return graph->nodeCount() - graph->overlay->disabledCount;
+}
+
+bool CSRGraph::HopSearch::watch(const std::string& id) {
+    int index = graph->indexOf(id);
+    if (index < 0 || graph->isDisabled(index)) {
+        watched.push_back(-1);
+        return false;
+    }
+    pending.push_back({watched.size(), index});
+    watched.push_back(index);
+    return true;
+}
+
+bool CSRGraph::HopSearch::start(const std::string& id) {
+    int index = graph->indexOf(id);
+    if (index < 0 || visited.test(index)) {
+        return false;
+    }
+    origin = index;
+    seeds.push_back(index);
+    return true;
+}
+
+bool CSRGraph::HopSearch::seedWatched(size_t position) {
+    int index = watched[position];
+    if (index < 0 || visited.test(index)) {
+        return false;
+    }
+    seeds.push_back(index);
+    return true;
+}
+
+size_t CSRGraph::HopSearch::advance(std::vector<size_t>& watchedReached) {
+    const Snapshot& graph = *this->graph;
+    const size_t words = visited.numWords();
+    std::atomic<size_t> levelReached{0};
+    std::atomic<size_t> levelJoined{0};
+    std::atomic<size_t> levelEdges{0};
+    
+    // A reached node joins the next frontier unless it is an airport,
+    // which may end a route but never be flown through
+    auto joinsFrontier = [&](int node, size_t& count, size_t& edges) {
+        ++count;
+        if (isAirport(*graph.node(node))) return false;
+        edges += graph.degree(node);
+        return true;
+    };
+    
+    if (!bottomUp && frontierEdges > unexploredEdges / BFS_ALPHA) {
+        bottomUp = true;
+    } else if (bottomUp && frontierSize < graph.nodeCount() / BFS_BETA) {
+        bottomUp = false;
+    }
+    bool expanding = frontierSize > 0;
+    
+    // next is never cleared in a pass of its own: bottom-up overwrites whole
+    // words of it, and top-down empties the frontier words it reads, so after
+    // a top-down level the old frontier comes back empty as next
+    if (nextDirty && !(expanding && bottomUp)) {
+        WorkerPool::shared().parallelFor(words, BFS_WORDS_PER_THREAD, [&](size_t begin, size_t end) {
+            next.clearWords(begin, end);
+        });
+    }
+    if (expanding && bottomUp) {
+        // Each worker owns a range of words, so only it writes those bits
+        WorkerPool::shared().parallelFor(words, BFS_WORDS_PER_THREAD, [&](size_t begin, size_t end) {
+            size_t count = 0, joined = 0, edges = 0;
+            for (size_t w = begin; w < end; ++w) {
+                uint64_t unvisited = ~visited.word(w) & visited.validMask(w);
+                uint64_t joinedBits = 0;
+                while (unvisited) {
+                    uint64_t bit = unvisited & -unvisited;
+                    int node = static_cast<int>(w * 64 + __builtin_ctzll(unvisited));
+                    unvisited &= unvisited - 1;
+                    bool hasParent = graph.anyNeighbor(node, [&](int neighbor, double) {
+                        return frontier.test(neighbor);
+                    });
+                    if (hasParent) {
+                        visited.set(node);
+                        if (joinsFrontier(node, count, edges)) {
+                            joinedBits |= bit;
+                            ++joined;
+                        }
+                    }
                 }
+                next.setWord(w, joinedBits);
             }
-            
-            current = prev;
+            levelReached += count;
+            levelJoined += joined;
+            levelEdges += edges;
+        });
+    } else if (expanding) {
+        WorkerPool::shared().parallelFor(words, BFS_WORDS_PER_THREAD, [&](size_t begin, size_t end) {
+            size_t count = 0, joined = 0, edges = 0;
+            for (size_t w = begin; w < end; ++w) {
+                uint64_t bits = frontier.takeWord(w);
+                while (bits) {
+                    int node = static_cast<int>(w * 64 + __builtin_ctzll(bits));
+                    bits &= bits - 1;
+                    graph.forEachNeighbor(node, [&](int neighbor, double) {
+                        if (visited.set(neighbor) && joinsFrontier(neighbor, count, edges)) {
+                            next.set(neighbor);
+                            ++joined;
+                        }
+                    });
+                }
+            }
+            levelReached += count;
+            levelJoined += joined;
+            levelEdges += edges;
+        });
+    }
+    nextDirty = expanding && bottomUp;
+    
+    size_t count = 0, joined = 0, edges = 0;
+    for (int node : seeds) {
+        if (!visited.set(node)) continue;
+        
+        // Routes may start at an airport
+        bool joins;
+        if (node == origin) {
+            ++count;
+            edges += graph.degree(node);
+            joins = true;
+        } else {
+            joins = joinsFrontier(node, count, edges);
+        }
+        if (joins) {
+            next.set(node);
+            ++joined;
+        }
+    }
+    seeds.clear();
+    
+    frontierSize = levelJoined + joined;
+    frontierEdges = static_cast<double>(levelEdges + edges);
+    unexploredEdges -= frontierEdges;
+    
+    for (size_t i = 0; i < pending.size();) {
+        if (visited.test(pending[i].second)) {
+            watchedReached.push_back(pending[i].first);
+            pending[i] = pending.back();
+            pending.pop_back();
+        } else {
+            ++i;
         }
-        result.path.push_back(start);
-        std::reverse(result.path.begin(), result.path.end());
-        result.totalDistance = totalDistance;
     }
     
+    std::swap(frontier, next);
+    return levelReached + count;
+}
+
+CSRGraph::HopResult CSRGraph::findHopCount(const std::string& start, const std::string& end) const {
+    ScopedTimer timer("search");
+    HopSearch search(*this);
+    HopResult result;
+    result.totalNodes = search.totalNodes();
+    if (!search.start(start) || (!end.empty() && !search.watch(end))) {
+        return result;
+    }
+    
+    // With an end, the search stops at its level, so this counts nodes within that many hops
+    std::vector<size_t> watchedReached;
+    for (int level = 0; !search.finished() && watchedReached.empty(); ++level) {
+        result.reachableNodes += search.advance(watchedReached);
+        if (!watchedReached.empty()) {
+            result.hops = level;
+        }
+    }
     return result;
 }
 
+std::vector<std::shared_ptr<Node>> CSRGraph::getNodes() const {
+    auto graph = snapshot();
+    std::vector<std::shared_ptr<Node>> result;
+    result.reserve(graph->nodeCount());
+    for (size_t i = 0; i < graph->nodeCount(); ++i) {
+        result.push_back(graph->node(i));
+    }
+    return result;
+}
+
+bool CSRGraph::isNodeEnabled(const std::string& id) const {
+    auto graph = snapshot();
+    int index = graph->indexOf(id);
+    return index >= 0 && !graph->isDisabled(index);
+}
+
 std::shared_ptr<Node> CSRGraph::getNode(const std::string& id) const {
-    auto it = nodeIndices.find(id);
-    if (it != nodeIndices.end()) {
-        return nodes[it->second];
+    auto graph = snapshot();
+    int index = graph->indexOf(id);
+    if (index >= 0) {
+        return graph->node(index);
     }
     return nullptr;
 }
@@ -1,6 +1,11 @@
 #pragma once
 #include "Node.hpp"
+#include "GraphOverlay.hpp"
+#include "SearchWorkspace.hpp"
+#include "AtomicBitset.hpp"
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -14,42 +19,228 @@ public:
         std::unordered_map<std::string, double> distances;
         std::unordered_map<std::string, std::string> previousNodes;
         
-        web::json::value toJson() const;
+        void writeJson(JsonWriter& writer) const;
     };
 
     // Structure to hold path finding results
     struct PathResult {
         std::vector<std::string> path;
-        double totalDistance;
+        double totalDistance = 0;
         std::vector<AlgorithmStep> steps;
+        // Set when the route crossed regions through thinned portals, so a
+        // slightly shorter crossing may exist
+        bool approximate = false;
         
-        web::json::value toJson() const;
+        void writeJson(JsonWriter& writer) const;
+        // Write only the path fields, without the opening/closing braces
+        void writeJsonFields(JsonWriter& writer, bool includeSteps = true) const;
     };
 
-    // Add a node to the graph
+    // Result of a hop-count query
+    struct HopResult {
+        int hops = -1;              // -1 when the end node was not reached
+        size_t reachableNodes = 0;  // nodes reached from the start, itself included
+        size_t totalNodes = 0;
+    };
+
+    // Callback receiving each algorithm step as soon as it is produced.
+    // When set, steps are handed to the callback instead of being buffered
+    // in PathResult::steps, and each lists only what changed since the one
+    // before: the newly visited nodes, the distances and predecessors set
+    // since, and the current frontier. Folding them together gives the
+    // buffered steps.
+    using StepCallback = std::function<void(const AlgorithmStep&)>;
+
+    // Runtime edits not yet compacted into the CSR arrays
+    struct EditStats {
+        size_t disabledNodes = 0;
+        size_t temporaryNodes = 0;
+        size_t maskedEdges = 0;
+        size_t extraEdges = 0;
+    };
+
+    CSRGraph();
+
+    // Add a node to the graph. addNode and connectNodesWithinRange build the
+    // graph in place and must not run concurrently with queries or edits.
     void addNode(std::shared_ptr<Node> node);
     
     // Connect nodes within specified range (in nautical miles)
     void connectNodesWithinRange(double maxDistance);
     
-    // Get nodes and edges for visualization
-    web::json::value getGraphVisualizationData() const;
+    // Runtime edits. Each one publishes a new overlay atomically, so queries
+    // already running keep the graph they started with.
+    bool disableNode(const std::string& id);
+    bool enableNode(const std::string& id);
+    // Connects the waypoint to every node within the build range; false if the id is taken
+    bool addTemporaryWaypoint(std::shared_ptr<Waypoint> waypoint);
+    // Close every edge touching the polygon; returns how many were closed
+    size_t closeAirspace(const std::vector<Coordinates>& polygon);
+    // Fold temporary nodes and edge closures back into fresh CSR arrays
+    void compact();
+    EditStats getEditStats() const;
+    
+    // Write nodes and edges for visualization, as bare array elements so
+    // several graphs can share one array
+    void writeVisualizationNodes(JsonWriter& writer) const;
+    void writeVisualizationEdges(JsonWriter& writer) const;
     
     // Path finding algorithms
-    PathResult findPathDijkstra(const std::string& start, const std::string& end);
-    PathResult findPathBFS(const std::string& start, const std::string& end);
+    PathResult findPathDijkstra(const std::string& start, const std::string& end,
+                                const StepCallback& onStep = nullptr) const;
+    PathResult findPathBFS(const std::string& start, const std::string& end,
+                           const StepCallback& onStep = nullptr) const;
+    
+    // Shortest path without step recording, between any two nodes
+    PathResult findShortestPath(const std::string& start, const std::string& end) const;
+    // Distances from start to each target, infinity where unreachable
+    std::vector<double> shortestDistances(const std::string& start,
+                                          const std::vector<std::string>& targets) const;
+    
+    // Parallel direction-optimizing BFS without step recording. With an empty
+    // end it explores everything reachable from start (connectivity check).
+    HopResult findHopCount(const std::string& start, const std::string& end) const;
+    // The same BFS one level at a time, so a caller can run the searches of
+    // several graphs in step and carry them across the edges between graphs
+    class HopSearch;
     
     // Get node by ID
     std::shared_ptr<Node> getNode(const std::string& id) const;
+    // All nodes, temporary ones included
+    std::vector<std::shared_ptr<Node>> getNodes() const;
+    // False for unknown and disabled nodes
+    bool isNodeEnabled(const std::string& id) const;
 
 private:
-    std::vector<std::shared_ptr<Node>> nodes;
-    std::vector<int> rowPtr;
-    std::vector<int> colIdx;
-    std::vector<double> values;
-    std::unordered_map<std::string, int> nodeIndices;
+    // CSR arrays; immutable once queries run, replaced wholesale by compaction
+    struct Topology {
+        std::vector<std::shared_ptr<Node>> nodes;
+        std::vector<int> rowPtr;
+        std::vector<int> colIdx;
+        std::vector<double> values;
+        std::unordered_map<std::string, int> nodeIndices;
+    };
+    
+    // The graph as one query sees it: CSR arrays plus the overlay of edits
+    struct Snapshot {
+        std::shared_ptr<const Topology> csr;
+        std::shared_ptr<const GraphOverlay> overlay;
+        
+        size_t baseCount() const { return csr->nodes.size(); }
+        size_t nodeCount() const { return csr->nodes.size() + overlay->temporaryNodes.size(); }
+        const std::shared_ptr<Node>& node(int index) const {
+            size_t base = csr->nodes.size();
+            return static_cast<size_t>(index) < base ? csr->nodes[index]
+                                                      : overlay->temporaryNodes[index - base];
+        }
+        // -1 if the id is unknown
+        int indexOf(const std::string& id) const;
+        bool isDisabled(int index) const { return overlay->isNodeDisabled(index); }
+        size_t degree(int index) const;
+        
+        // Call fn(neighbor, distance) for each open edge of a node, skipping
+        // closed edges and disabled neighbors
+        template <typename Fn>
+        void forEachNeighbor(int index, const Fn& fn) const {
+            anyNeighbor(index, [&fn](int neighbor, double distance) {
+                fn(neighbor, distance);
+                return false;
+            });
+        }
+        
+        // Like forEachNeighbor, but stops at the first edge the predicate accepts
+        template <typename Pred>
+        bool anyNeighbor(int index, const Pred& pred) const {
+            if (static_cast<size_t>(index) < csr->nodes.size()) {
+                for (int i = csr->rowPtr[index]; i < csr->rowPtr[index + 1]; ++i) {
+                    int neighbor = csr->colIdx[i];
+                    if (overlay->isEdgeMasked(i) || overlay->isNodeDisabled(neighbor)) continue;
+                    if (pred(neighbor, csr->values[i])) return true;
+                }
+            }
+            if (const auto* extra = overlay->edgesFrom(index)) {
+                for (const auto& edge : *extra) {
+                    if (overlay->isNodeDisabled(edge.first)) continue;
+                    if (pred(edge.first, edge.second)) return true;
+                }
+            }
+            return false;
+        }
+    };
+    
+    // Graph being built; also the CSR of the current snapshot
+    std::shared_ptr<Topology> topology;
+    // Current snapshot, read and replaced with std::atomic_load/atomic_store
+    std::shared_ptr<const Snapshot> current;
+    // Range used to connect nodes, reused for temporary waypoints
+    double connectRange = 0;
+    // Serializes edits and compaction
+    std::mutex editMutex;
+    
+    std::shared_ptr<const Snapshot> snapshot() const { return std::atomic_load(&current); }
+    void publish(std::shared_ptr<const Topology> csr, std::shared_ptr<const GraphOverlay> overlay);
+    // Compact once the overlay grows past its limits; editMutex must be held
+    void compactIfNeeded();
+    void compactLocked();
     
     // Helper method to add an edge
     void addEdge(int from, int to, double weight);
+    
+    // Search workspaces reused across queries; each concurrent search leases one
+    class WorkspaceLease;
+    mutable std::mutex workspaceMutex;
+    mutable std::vector<std::unique_ptr<SearchWorkspace>> workspacePool;
+    std::unique_ptr<SearchWorkspace> acquireWorkspace() const;
+    void releaseWorkspace(std::unique_ptr<SearchWorkspace> workspace) const;
+    
+    // Search helpers shared by Dijkstra and BFS
+    static bool canTraverse(const Snapshot& graph, int node, int target);
+    static AlgorithmStep recordStep(const Snapshot& graph, SearchWorkspace& workspace,
+                                    int current, int target, bool hopCounts, bool delta);
+    static void runDijkstra(const Snapshot& graph, SearchWorkspace& workspace, int source, int target,
+                            PathResult* steps, const StepCallback& onStep,
+                            const std::vector<int>* settle = nullptr);
+    static void reconstructPath(const Snapshot& graph, const SearchWorkspace& workspace,
+                                int start, int end, PathResult& result);
+    
+    // Hand a delta step to the callback, or buffer a full one in the result if there is none
+    static void emitStep(const Snapshot& graph, SearchWorkspace& workspace, int current, int target,
+                         bool hopCounts, PathResult& result, const StepCallback& onStep);
 };
 
+class CSRGraph::HopSearch {
+public:
+    explicit HopSearch(const CSRGraph& graph);
+    
+    // Nodes that are not disabled, as in HopResult::totalNodes
+    size_t totalNodes() const;
+    // Watched nodes are reported by advance() once reached, by the order they
+    // were watched in. False for unknown and disabled nodes, which never are.
+    bool watch(const std::string& id);
+    // Add a node to the next level; false for unknown, disabled and already
+    // reached nodes. start() seeds where the search starts, which is flown
+    // from even if it is an airport; other seeded airports are reached but
+    // not flown through. seedWatched() takes a position as from watch().
+    bool start(const std::string& id);
+    bool seedWatched(size_t position);
+    // Expand the frontier by one level and take in the seeds. Returns how
+    // many nodes were reached and appends the watched ones among them.
+    size_t advance(std::vector<size_t>& watchedReached);
+    // Nothing left to expand or seed
+    bool finished() const { return frontierSize == 0 && seeds.empty(); }
+
+private:
+    std::shared_ptr<const Snapshot> graph;
+    AtomicBitset visited;
+    AtomicBitset frontier;
+    AtomicBitset next;
+    std::vector<int> seeds;
+    int origin = -1;
+    std::vector<int> watched;  // by position; -1 for unknown and disabled nodes
+    std::vector<std::pair<size_t, int>> pending;  // watched position, node
+    size_t frontierSize = 0;
+    double frontierEdges = 0;
+    double unexploredEdges;
+    bool bottomUp = false;
+    bool nextDirty = false;  // next holds bits from before the last level
+};
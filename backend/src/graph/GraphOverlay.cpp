@@ -0,0 +1,104 @@
+#include "GraphOverlay.hpp"
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+bool GraphOverlay::setBit(std::vector<uint64_t>& bits, size_t index, bool value) {
+    size_t word = index >> 6;
+    if (word >= bits.size()) {
+        if (!value) return false;
+        bits.resize(word + 1, 0);
+    }
+    
+    uint64_t mask = uint64_t(1) << (index & 63);
+    bool wasSet = bits[word] & mask;
+    if (value) {
+        bits[word] |= mask;
+    } else {
+        bits[word] &= ~mask;
+    }
+    return wasSet != value;
+}
+
+namespace {
+
+// Sign of the cross product (b - a) x (c - a)
+int orientation(const Coordinates& a, const Coordinates& b, const Coordinates& c) {
+    double cross = (b.longitude - a.longitude) * (c.latitude - a.latitude) -
+                   (b.latitude - a.latitude) * (c.longitude - a.longitude);
+    return (cross > 0) - (cross < 0);
+}
+
+bool onSegment(const Coordinates& a, const Coordinates& b, const Coordinates& p) {
+    return std::min(a.latitude, b.latitude) <= p.latitude && p.latitude <= std::max(a.latitude, b.latitude) &&
+           std::min(a.longitude, b.longitude) <= p.longitude && p.longitude <= std::max(a.longitude, b.longitude);
+}
+
+bool segmentsIntersect(const Coordinates& a, const Coordinates& b,
+                       const Coordinates& c, const Coordinates& d) {
+    int o1 = orientation(a, b, c);
+    int o2 = orientation(a, b, d);
+    int o3 = orientation(c, d, a);
+    int o4 = orientation(c, d, b);
+    
+    if (o1 != o2 && o3 != o4) return true;
+    
+    // Collinear cases
+    return (o1 == 0 && onSegment(a, b, c)) || (o2 == 0 && onSegment(a, b, d)) ||
+           (o3 == 0 && onSegment(c, d, a)) || (o4 == 0 && onSegment(c, d, b));
+}
+
+// Ray casting along the latitude axis
+bool pointInPolygon(const Coordinates& p, const std::vector<Coordinates>& polygon) {
+    bool inside = false;
+    for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+        const Coordinates& a = polygon[i];
+        const Coordinates& b = polygon[j];
+        if ((a.latitude > p.latitude) != (b.latitude > p.latitude)) {
+            double crossing = a.longitude + (p.latitude - a.latitude) *
+                              (b.longitude - a.longitude) / (b.latitude - a.latitude);
+            if (p.longitude < crossing) {
+                inside = !inside;
+            }
+        }
+    }
+    return inside;
+}
+
+} // namespace
+
+bool GraphOverlay::segmentTouchesPolygon(const Coordinates& a, const Coordinates& b,
+                                         const std::vector<Coordinates>& polygon) {
+    if (polygon.size() < 3) return false;
+    
+    if (pointInPolygon(a, polygon) || pointInPolygon(b, polygon)) {
+        return true;
+    }
+    for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+        if (segmentsIntersect(a, b, polygon[j], polygon[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+GraphOverlay::ClosedArea::ClosedArea(std::vector<Coordinates> vertices)
+    : polygon(std::move(vertices)),
+      minLat(std::numeric_limits<double>::infinity()), maxLat(-minLat),
+      minLng(minLat), maxLng(-minLat) {
+    for (const auto& vertex : polygon) {
+        minLat = std::min(minLat, vertex.latitude);
+        maxLat = std::max(maxLat, vertex.latitude);
+        minLng = std::min(minLng, vertex.longitude);
+        maxLng = std::max(maxLng, vertex.longitude);
+    }
+}
+
+bool GraphOverlay::ClosedArea::touches(const Coordinates& a, const Coordinates& b) const {
+    // Cheap bounding-box rejection before the exact segment test
+    if (std::max(a.latitude, b.latitude) < minLat || std::min(a.latitude, b.latitude) > maxLat ||
+        std::max(a.longitude, b.longitude) < minLng || std::min(a.longitude, b.longitude) > maxLng) {
+        return false;
+    }
+    return segmentTouchesPolygon(a, b, polygon);
+}
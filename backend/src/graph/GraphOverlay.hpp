@@ -0,0 +1,69 @@
+#pragma once
+#include "Node.hpp"
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Runtime edits layered over the immutable CSR arrays: closed nodes, closed
+// edge slots, temporary nodes and the extra edges connecting them. A published
+// overlay is never modified; edits copy it, change the copy and republish.
+struct GraphOverlay {
+    using Edge = std::pair<int, double>;  // neighbor index, distance
+    
+    std::vector<uint64_t> disabledNodes;  // one bit per node index
+    std::vector<uint64_t> maskedEdges;    // one bit per CSR edge slot
+    
+    // Temporary nodes take the indices after the CSR nodes, in insertion order
+    std::vector<std::shared_ptr<Node>> temporaryNodes;
+    std::unordered_map<std::string, int> temporaryIndices;
+    std::unordered_map<int, std::vector<Edge>> extraEdges;
+    
+    // A closed airspace polygon with its bounding box for quick rejection
+    struct ClosedArea {
+        std::vector<Coordinates> polygon;
+        double minLat, maxLat, minLng, maxLng;
+        
+        explicit ClosedArea(std::vector<Coordinates> polygon);
+        bool touches(const Coordinates& a, const Coordinates& b) const;
+    };
+    
+    // Kept across compaction so edges added later stay out of closed airspace
+    std::vector<ClosedArea> closedAreas;
+    
+    size_t disabledCount = 0;
+    size_t maskedCount = 0;
+    size_t extraEdgeCount = 0;
+    
+    bool isNodeDisabled(int index) const { return testBit(disabledNodes, index); }
+    bool isEdgeMasked(int slot) const { return testBit(maskedEdges, slot); }
+    
+    bool isClosed(const Coordinates& a, const Coordinates& b) const {
+        for (const auto& area : closedAreas) {
+            if (area.touches(a, b)) return true;
+        }
+        return false;
+    }
+    
+    // Extra edges leaving a node, or nullptr if it has none
+    const std::vector<Edge>* edgesFrom(int index) const {
+        if (extraEdges.empty()) return nullptr;
+        auto it = extraEdges.find(index);
+        return it != extraEdges.end() ? &it->second : nullptr;
+    }
+    
+    static bool testBit(const std::vector<uint64_t>& bits, size_t index) {
+        size_t word = index >> 6;
+        return word < bits.size() && ((bits[word] >> (index & 63)) & 1);
+    }
+    
+    // Set or clear a bit, growing the vector as needed; returns true if it changed
+    static bool setBit(std::vector<uint64_t>& bits, size_t index, bool value);
+    
+    // Whether the segment a-b has an endpoint inside the polygon or crosses its
+    // boundary. Coordinates are treated as planar lat/lng, which is adequate at
+    // the scale of a closed airspace.
+    static bool segmentTouchesPolygon(const Coordinates& a, const Coordinates& b,
+                                      const std::vector<Coordinates>& polygon);
+};
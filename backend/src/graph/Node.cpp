@@ -1,9 +1,5 @@
 #include "Node.hpp"
 #include <cmath>
-#include <cpprest/json.h>
-
-
-using namespace web;
 
 double Coordinates::distanceTo(const Coordinates& other) const {
     const double R = 3440.065; // Earth's radius in nautical miles
@@ -22,13 +18,17 @@ double Coordinates::distanceTo(const Coordinates& other) const {
 Node::Node(const std::string& id, const Coordinates& coords, Type type)
     : id(id), coordinates(coords), type(type) {}
 
-web::json::value Node::toJson() const {
-    web::json::value json;
-    json[U("id")] = web::json::value::string(utility::conversions::to_string_t(id));
-    json[U("lat")] = coordinates.latitude;
-    json[U("lng")] = coordinates.longitude;
-    json[U("type")] = static_cast<int>(type);
-    return json;
+void Node::writeJson(JsonWriter& writer) const {
+    writer.beginObject();
+    writeJsonFields(writer);
+    writer.endObject();
+}
+
+void Node::writeJsonFields(JsonWriter& writer) const {
+    writer.key("id").value(id);
+    writer.key("lat").value(coordinates.latitude);
+    writer.key("lng").value(coordinates.longitude);
+    writer.key("type").value(static_cast<int>(type));
 }
 
 Airport::Airport(const std::string& icao, const std::string& name,
@@ -37,13 +37,12 @@ Airport::Airport(const std::string& icao, const std::string& name,
     : Node(icao, coords, Type::AIRPORT),
       name(name), city(city), country(country), elevation(elevation) {}
 
-web::json::value Airport::toJson() const {
-    auto json = Node::toJson();
-    json[U("name")] = web::json::value::string(utility::conversions::to_string_t(name));
-    json[U("city")] = web::json::value::string(utility::conversions::to_string_t(city));
-    json[U("country")] = web::json::value::string(utility::conversions::to_string_t(country));
-    json[U("elevation")] = elevation;
-    return json;
+void Airport::writeJsonFields(JsonWriter& writer) const {
+    Node::writeJsonFields(writer);
+    writer.key("name").value(name);
+    writer.key("city").value(city);
+    writer.key("country").value(country);
+    writer.key("elevation").value(elevation);
 }
 
 Waypoint::Waypoint(const std::string& ident, const std::string& countryCode,
@@ -51,9 +50,8 @@ Waypoint::Waypoint(const std::string& ident, const std::string& countryCode,
     : Node(ident, coords, Type::WAYPOINT),
       countryCode(countryCode), countryName(countryName) {}
 
-web::json::value Waypoint::toJson() const {
-    auto json = Node::toJson();
-    json[U("countryCode")] = web::json::value::string(utility::conversions::to_string_t(countryCode));
-    json[U("countryName")] = web::json::value::string(utility::conversions::to_string_t(countryName));
-    return json;
+void Waypoint::writeJsonFields(JsonWriter& writer) const {
+    Node::writeJsonFields(writer);
+    writer.key("countryCode").value(countryCode);
+    writer.key("countryName").value(countryName);
 }
@@ -1,9 +1,7 @@
 #pragma once
 #include <string>
 #include <vector>
-#include <cpprest/json.h>
-
-using namespace web;
+#include "../utils/JsonWriter.hpp"
 
 struct Coordinates {
     double latitude;
@@ -22,12 +20,16 @@ public:
 
     Node(const std::string& id, const Coordinates& coords, Type type);
     
-    std::string getId() const { return id; }
+    const std::string& getId() const { return id; }
     Coordinates getCoordinates() const { return coordinates; }
     Type getType() const { return type; }
     
     // Serialization for JSON responses
-    virtual web::json::value toJson() const;
+    void writeJson(JsonWriter& writer) const;
+
+protected:
+    // Write this node's fields into an already open JSON object
+    virtual void writeJsonFields(JsonWriter& writer) const;
 
 private:
     std::string id;
@@ -46,7 +48,8 @@ public:
     std::string getCountry() const { return country; }
     int getElevation() const { return elevation; }
 
-    web::json::value toJson() const override;
+protected:
+    void writeJsonFields(JsonWriter& writer) const override;
 
 private:
     std::string name;
@@ -63,7 +66,8 @@ public:
     std::string getCountryCode() const { return countryCode; }
     std::string getCountryName() const { return countryName; }
 
-    web::json::value toJson() const override;
+protected:
+    void writeJsonFields(JsonWriter& writer) const override;
 
 private:
     std::string countryCode;
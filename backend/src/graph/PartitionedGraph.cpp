@@ -0,0 +1,714 @@
+#include "PartitionedGraph.hpp"
+#include "../utils/Trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <map>
+#include <tuple>
+#include <utility>
+
+namespace {
+
+constexpr double INF = std::numeric_limits<double>::infinity();
+
+// Grid cell, in degrees, within which one crossing per border side is kept
+constexpr double PORTAL_CELL_DEGREES = 1.0;
+
+bool isAirport(const Node& node) {
+    return node.getType() == Node::Type::AIRPORT;
+}
+
+} // namespace
+
+void PartitionedGraph::addPartition(const std::string& region, std::shared_ptr<CSRGraph> graph) {
+    Partition partition{region, graph, INF, -INF, INF, -INF};
+    int index = static_cast<int>(partitions.size());
+    
+    for (const auto& node : graph->getNodes()) {
+        nodePartition.emplace(node->getId(), index);
+        Coordinates coords = node->getCoordinates();
+        partition.minLat = std::min(partition.minLat, coords.latitude);
+        partition.maxLat = std::max(partition.maxLat, coords.latitude);
+        partition.minLng = std::min(partition.minLng, coords.longitude);
+        partition.maxLng = std::max(partition.maxLng, coords.longitude);
+    }
+    
+    partitions.push_back(std::move(partition));
+    regionRevisions.push_back(0);
+    shortcutCache.emplace_back();
+}
+
+void PartitionedGraph::connectPartitions(double maxDistance) {
+    crossEdges.clear();
+    
+    for (size_t p = 0; p < partitions.size(); ++p) {
+        auto fromNodes = partitions[p].graph->getNodes();
+        for (size_t q = p + 1; q < partitions.size(); ++q) {
+            const Partition& other = partitions[q];
+            auto toNodes = other.graph->getNodes();
+            
+            // Only nodes within range of the other region's bounds can have a
+            // cross edge (a degree of latitude is 60 nm; longitude shrinks poleward)
+            double latMargin = maxDistance / 60.0;
+            double maxAbsLat = std::min(89.0, std::max(std::abs(other.minLat), std::abs(other.maxLat)) + latMargin);
+            double lngMargin = std::min(180.0, latMargin / std::cos(maxAbsLat * M_PI / 180.0));
+            
+            for (const auto& from : fromNodes) {
+                Coordinates a = from->getCoordinates();
+                if (a.latitude < other.minLat - latMargin || a.latitude > other.maxLat + latMargin ||
+                    a.longitude < other.minLng - lngMargin || a.longitude > other.maxLng + lngMargin) {
+                    continue;
+                }
+                
+                for (const auto& to : toNodes) {
+                    Coordinates b = to->getCoordinates();
+                    double distance = a.distanceTo(b);
+                    if (distance <= maxDistance) {
+                        crossEdges.push_back({static_cast<int>(p), static_cast<int>(q),
+                                              from->getId(), to->getId(), a, b, distance,
+                                              isAirport(*from) || isAirport(*to)});
+                    }
+                }
+            }
+        }
+    }
+    
+    crossingEnds.assign(partitions.size(), {});
+    std::vector<std::unordered_map<std::string, size_t>> endIndex(partitions.size());
+    auto addEnd = [&](int partition, const std::string& id) {
+        auto inserted = endIndex[partition].emplace(id, crossingEnds[partition].size());
+        if (inserted.second) {
+            crossingEnds[partition].push_back({id, isAirport(*partitions[partition].graph->getNode(id)), {}});
+        }
+        return inserted.first->second;
+    };
+    for (size_t i = 0; i < crossEdges.size(); ++i) {
+        const CrossEdge& edge = crossEdges[i];
+        size_t from = addEnd(edge.fromPartition, edge.from);
+        size_t to = addEnd(edge.toPartition, edge.to);
+        crossingEnds[edge.fromPartition][from].links.push_back({i, edge.toPartition, to});
+        crossingEnds[edge.toPartition][to].links.push_back({i, edge.fromPartition, from});
+    }
+    
+    std::atomic_store(&overlay, std::shared_ptr<const Overlay>());
+}
+
+int PartitionedGraph::partitionIndex(const std::string& id) const {
+    auto it = nodePartition.find(id);
+    if (it != nodePartition.end()) {
+        return it->second;
+    }
+    
+    // Temporary waypoints are not in the load-time index
+    for (size_t i = 0; i < partitions.size(); ++i) {
+        if (partitions[i].graph->getNode(id)) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+std::shared_ptr<CSRGraph> PartitionedGraph::partitionOf(const std::string& id) const {
+    int index = partitionIndex(id);
+    return index >= 0 ? partitions[index].graph : nullptr;
+}
+
+bool PartitionedGraph::sameRegion(const std::string& a, const std::string& b) const {
+    int index = partitionIndex(a);
+    return index >= 0 && index == partitionIndex(b);
+}
+
+std::shared_ptr<Node> PartitionedGraph::getNode(const std::string& id) const {
+    auto graph = partitionOf(id);
+    return graph ? graph->getNode(id) : nullptr;
+}
+
+std::vector<GraphOverlay::ClosedArea> PartitionedGraph::closedAreas() const {
+    std::lock_guard<std::mutex> lock(editMutex);
+    return closedAirspace;
+}
+
+bool PartitionedGraph::crossEdgeOpen(const CrossEdge& edge,
+                                     const std::vector<GraphOverlay::ClosedArea>& closed) const {
+    if (!partitions[edge.fromPartition].graph->isNodeEnabled(edge.from) ||
+        !partitions[edge.toPartition].graph->isNodeEnabled(edge.to)) {
+        return false;
+    }
+    return !crossesClosedArea(edge, closed);
+}
+
+bool PartitionedGraph::crossesClosedArea(const CrossEdge& edge, const std::vector<GraphOverlay::ClosedArea>& closed) {
+    return std::any_of(closed.begin(), closed.end(), [&](const GraphOverlay::ClosedArea& area) {
+        return area.touches(edge.fromCoords, edge.toCoords);
+    });
+}
+
+void PartitionedGraph::markEdited(int partition) {
+    std::lock_guard<std::mutex> lock(editMutex);
+    if (partition >= 0) {
+        ++regionRevisions[partition];
+    } else {
+        for (auto& revision : regionRevisions) {
+            ++revision;
+        }
+    }
+    ++editRevision;
+}
+
+std::shared_ptr<const PartitionedGraph::Overlay> PartitionedGraph::currentOverlay(bool allowStale) const {
+    auto published = std::atomic_load(&overlay);
+    if (published && published->revision == editRevision.load()) {
+        return published;
+    }
+    
+    std::unique_lock<std::mutex> lock(rebuildMutex, std::defer_lock);
+    if (allowStale && published) {
+        if (!lock.try_lock()) {
+            return published;
+        }
+    } else {
+        lock.lock();
+    }
+    
+    // Another thread may have finished a rebuild while this one waited
+    published = std::atomic_load(&overlay);
+    if (published && published->revision == editRevision.load()) {
+        return published;
+    }
+    published = buildOverlay();
+    std::atomic_store(&overlay, published);
+    return published;
+}
+
+std::shared_ptr<const PartitionedGraph::RegionShortcuts> PartitionedGraph::regionShortcuts(
+    int partition, uint64_t revision, std::vector<std::string> boundary) const {
+    
+    auto& cached = shortcutCache[partition];
+    if (cached && cached->revision == revision && cached->boundary == boundary) {
+        return cached;
+    }
+    
+    auto shortcuts = std::make_shared<RegionShortcuts>();
+    shortcuts->revision = revision;
+    shortcuts->boundary = std::move(boundary);
+    // Region graphs are symmetric, so each search only needs the boundary
+    // nodes after its source and can stop as soon as it has settled those
+    const CSRGraph& graph = *partitions[partition].graph;
+    const auto& ids = shortcuts->boundary;
+    auto& distances = shortcuts->distances;
+    distances.assign(ids.size(), std::vector<double>(ids.size(), INF));
+    for (size_t i = 0; i < ids.size(); ++i) {
+        distances[i][i] = 0;
+        std::vector<std::string> later(ids.begin() + i + 1, ids.end());
+        auto row = graph.shortestDistances(ids[i], later);
+        for (size_t j = 0; j < later.size(); ++j) {
+            distances[i][i + 1 + j] = distances[i + 1 + j][i] = row[j];
+        }
+    }
+    
+    cached = shortcuts;
+    return shortcuts;
+}
+
+std::shared_ptr<const PartitionedGraph::Overlay> PartitionedGraph::buildOverlay() const {
+    ScopedTimer timer("overlay");
+    auto result = std::make_shared<Overlay>();
+    std::vector<uint64_t> revisions;
+    std::vector<GraphOverlay::ClosedArea> closed;
+    {
+        // Edits bump revisions after changing the regions, so state read
+        // from here on is at least as new as these
+        std::lock_guard<std::mutex> lock(editMutex);
+        result->revision = editRevision.load();
+        revisions = regionRevisions;
+        closed = closedAirspace;
+    }
+    
+    // Portals: of the open crossings between two grid cells on either side
+    // of a border, only the shortest is kept. Airports only start or end a
+    // route, so crossings ending at one are thinned apart from the waypoint
+    // crossings that routes pass through.
+    auto cell = [](const Coordinates& coords) {
+        return std::make_pair(static_cast<int>(std::floor(coords.latitude / PORTAL_CELL_DEGREES)),
+                              static_cast<int>(std::floor(coords.longitude / PORTAL_CELL_DEGREES)));
+    };
+    std::map<std::tuple<int, std::pair<int, int>, int, std::pair<int, int>, bool>, size_t> portals;
+    for (size_t i = 0; i < crossEdges.size(); ++i) {
+        const CrossEdge& edge = crossEdges[i];
+        if (!crossEdgeOpen(edge, closed)) continue;
+        
+        auto key = std::make_tuple(edge.fromPartition, cell(edge.fromCoords), edge.toPartition, cell(edge.toCoords),
+                                   edge.airportEnded);
+        auto inserted = portals.emplace(key, i);
+        if (!inserted.second && edge.distance < crossEdges[inserted.first->second].distance) {
+            inserted.first->second = i;
+        }
+    }
+    
+    std::vector<size_t> kept;
+    kept.reserve(portals.size());
+    for (const auto& portal : portals) {
+        kept.push_back(portal.second);
+    }
+    std::sort(kept.begin(), kept.end());
+    kept.erase(std::unique(kept.begin(), kept.end()), kept.end());
+    
+    // Boundary nodes in a stable order, so unchanged regions hit the cache
+    std::vector<std::vector<std::string>> boundaries(partitions.size());
+    for (size_t i : kept) {
+        boundaries[crossEdges[i].fromPartition].push_back(crossEdges[i].from);
+        boundaries[crossEdges[i].toPartition].push_back(crossEdges[i].to);
+    }
+    
+    result->byPartition.resize(partitions.size());
+    std::vector<std::unordered_map<std::string, int>> indices(partitions.size());
+    for (size_t p = 0; p < partitions.size(); ++p) {
+        auto& ids = boundaries[p];
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        
+        for (const auto& id : ids) {
+            int index = static_cast<int>(result->ids.size());
+            indices[p].emplace(id, index);
+            result->partition.push_back(static_cast<int>(p));
+            result->ids.push_back(id);
+            result->airport.push_back(isAirport(*partitions[p].graph->getNode(id)));
+            result->edges.emplace_back();
+            result->byPartition[p].push_back(index);
+        }
+    }
+    
+    for (size_t i : kept) {
+        const CrossEdge& edge = crossEdges[i];
+        int from = indices[edge.fromPartition].at(edge.from);
+        int to = indices[edge.toPartition].at(edge.to);
+        int cross = static_cast<int>(i);
+        result->edges[from].push_back({to, edge.distance, cross});
+        result->edges[to].push_back({from, edge.distance, cross});
+    }
+    
+    // Shortcuts between the boundary nodes of each region, recomputed only
+    // for regions that changed
+    for (size_t p = 0; p < partitions.size(); ++p) {
+        const auto& members = result->byPartition[p];
+        if (members.empty()) continue;
+        
+        auto shortcuts = regionShortcuts(static_cast<int>(p), revisions[p], boundaries[p]);
+        for (size_t i = 0; i < members.size(); ++i) {
+            for (size_t j = 0; j < members.size(); ++j) {
+                double distance = shortcuts->distances[i][j];
+                if (i != j && distance < INF) {
+                    result->edges[members[i]].push_back({members[j], distance, -1});
+                }
+            }
+        }
+    }
+    
+    return result;
+}
+
+CSRGraph::PathResult PartitionedGraph::findPathDijkstra(const std::string& start, const std::string& end,
+                                                        const CSRGraph::StepCallback& onStep) const {
+    int startPartition = partitionIndex(start);
+    int endPartition = partitionIndex(end);
+    if (startPartition < 0 || endPartition < 0) {
+        return CSRGraph::PathResult();
+    }
+    
+    if (startPartition == endPartition) {
+        return partitions[startPartition].graph->findPathDijkstra(start, end, onStep);
+    }
+    
+    ScopedTimer timer("search");
+    CSRGraph::PathResult result;
+    
+    // Routes run from airport to airport, as within a region
+    auto startNode = partitions[startPartition].graph->getNode(start);
+    auto endNode = partitions[endPartition].graph->getNode(end);
+    if (!startNode || !endNode || !isAirport(*startNode) || !isAirport(*endNode)) {
+        return result;
+    }
+    
+    // While another query rebuilds the overlay, try the previous one. An edit
+    // can overtake any attempt, so steps are held back until the attempt's
+    // route checks out against the regions or no retry is needed.
+    std::vector<CSRGraph::AlgorithmStep> held;
+    CSRGraph::StepCallback hold;
+    if (onStep) {
+        hold = [&held](const CSRGraph::AlgorithmStep& step) { held.push_back(step); };
+    }
+    auto boundary = currentOverlay(true);
+    bool found = searchOverlay(*boundary, startPartition, endPartition, start, end, hold, result);
+    if (!found && boundary->revision != editRevision.load()) {
+        // The regions were edited under this overlay; search again on a
+        // current one, whose steps replace the held ones
+        held.clear();
+        result = CSRGraph::PathResult();
+        searchOverlay(*currentOverlay(false), startPartition, endPartition, start, end, hold, result);
+    }
+    
+    for (const auto& step : held) {
+        onStep(step);
+    }
+    return result;
+}
+
+bool PartitionedGraph::searchOverlay(const Overlay& boundary, int startPartition, int endPartition,
+                                     const std::string& start, const std::string& end,
+                                     const CSRGraph::StepCallback& onStep, CSRGraph::PathResult& result) const {
+    const CSRGraph& startGraph = *partitions[startPartition].graph;
+    const CSRGraph& endGraph = *partitions[endPartition].graph;
+    const auto& startMembers = boundary.byPartition[startPartition];
+    const auto& endMembers = boundary.byPartition[endPartition];
+    if (startMembers.empty() || endMembers.empty()) {
+        return false;
+    }
+    
+    // Distances from start to its region's boundary, and from the end region's
+    // boundary to end (region graphs are symmetric)
+    auto idsOf = [&](const std::vector<int>& members) {
+        std::vector<std::string> ids;
+        for (int member : members) {
+            ids.push_back(boundary.ids[member]);
+        }
+        return ids;
+    };
+    auto startDistances = startGraph.shortestDistances(start, idsOf(startMembers));
+    auto endDistances = endGraph.shortestDistances(end, idsOf(endMembers));
+    
+    // Dijkstra over the overlay plus a virtual node standing for the end
+    const int target = static_cast<int>(boundary.ids.size());
+    std::vector<double> toEnd(target, INF);
+    for (size_t i = 0; i < endMembers.size(); ++i) {
+        toEnd[endMembers[i]] = endDistances[i];
+    }
+    
+    std::vector<double> distance(target + 1, INF);
+    std::vector<int> previous(target + 1, -1);
+    std::vector<int> via(target + 1, -1);  // cross edge taken into the node, if any
+    std::vector<char> visited(target + 1, 0);
+    std::vector<int> reachedOrder;
+    std::vector<int> visitedOrder;
+    std::vector<int> changed;  // relaxed since the last streamed step
+    std::vector<std::pair<double, int>> heap;
+    auto compare = std::greater<std::pair<double, int>>();
+    
+    auto relax = [&](int node, double value, int from, int cross) {
+        if (value < distance[node]) {
+            if (distance[node] == INF) reachedOrder.push_back(node);
+            if (onStep) changed.push_back(node);
+            distance[node] = value;
+            previous[node] = from;
+            via[node] = cross;
+            heap.push_back({value, node});
+            std::push_heap(heap.begin(), heap.end(), compare);
+        }
+    };
+    auto idOf = [&](int node) -> const std::string& {
+        return node == target ? end : boundary.ids[node];
+    };
+    auto isStart = [&](int node) {
+        return boundary.partition[node] == startPartition && boundary.ids[node] == start;
+    };
+    auto isEnd = [&](int node) {
+        return boundary.partition[node] == endPartition && boundary.ids[node] == end;
+    };
+    // When the end airport has cross edges of its own, it already stands for
+    // the end in the steps and the virtual node stays out of them
+    bool endOnBoundary = false;
+    for (int member : endMembers) {
+        endOnBoundary = endOnBoundary || isEnd(member);
+    }
+    
+    for (size_t i = 0; i < startMembers.size(); ++i) {
+        if (startDistances[i] < INF && (!boundary.airport[startMembers[i]] || isStart(startMembers[i]))) {
+            relax(startMembers[i], startDistances[i], -1, -1);
+        }
+    }
+    
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), compare);
+        int current = heap.back().second;
+        heap.pop_back();
+        
+        if (visited[current]) continue;
+        visited[current] = 1;
+        visitedOrder.push_back(current);
+        
+        // Steps describe the overlay search; legs inside regions are not
+        // stepped. Streamed steps are deltas, as within a region.
+        CSRGraph::AlgorithmStep step;
+        step.currentNode = idOf(current);
+        const std::vector<int> visitedNow{current};
+        for (int node : onStep ? visitedNow : visitedOrder) {
+            if (node == target && endOnBoundary) continue;
+            step.visitedNodes.push_back(idOf(node));
+        }
+        for (int node : onStep ? changed : reachedOrder) {
+            if (node == target && endOnBoundary) continue;
+            step.distances[idOf(node)] = distance[node];
+            step.previousNodes[idOf(node)] = previous[node] >= 0 ? idOf(previous[node]) : start;
+        }
+        changed.clear();
+        // Other airports are dead ends, and the end airport only leads to the end
+        bool expand = current != target && (!boundary.airport[current] || isStart(current));
+        if (expand) {
+            for (const auto& edge : boundary.edges[current]) {
+                if (!visited[edge.to] && (!boundary.airport[edge.to] || isEnd(edge.to))) {
+                    step.frontier.push_back(idOf(edge.to));
+                }
+            }
+        }
+        if (current != target && toEnd[current] < INF && !visited[target] && !isEnd(current)) {
+            step.frontier.push_back(end);
+        }
+        if (onStep) {
+            onStep(step);
+        } else {
+            result.steps.push_back(std::move(step));
+        }
+        
+        if (current == target) break;
+        
+        if (expand) {
+            for (const auto& edge : boundary.edges[current]) {
+                if (!boundary.airport[edge.to] || isEnd(edge.to)) {
+                    relax(edge.to, distance[current] + edge.distance, current, edge.cross);
+                }
+            }
+        }
+        if (toEnd[current] < INF && (!boundary.airport[current] || isEnd(current) || isStart(current))) {
+            relax(target, distance[current] + toEnd[current], current, -1);
+        }
+    }
+    
+    if (!visited[target]) {
+        return false;
+    }
+    
+    // Expand the overlay route back into waypoints: start leg, cross edges and
+    // shortcuts, end leg
+    std::vector<int> route;
+    for (int node = previous[target]; node >= 0; node = previous[node]) {
+        route.push_back(node);
+    }
+    std::reverse(route.begin(), route.end());
+    
+    auto append = [&](const CSRGraph::PathResult& leg) {
+        if (leg.path.empty()) return false;
+        result.path.insert(result.path.end(), result.path.empty() ? leg.path.begin() : leg.path.begin() + 1,
+                           leg.path.end());
+        result.totalDistance += leg.totalDistance;
+        return true;
+    };
+    
+    auto closed = closedAreas();
+    bool complete = append(startGraph.findShortestPath(start, boundary.ids[route.front()]));
+    for (size_t i = 1; complete && i < route.size(); ++i) {
+        int from = route[i - 1];
+        int to = route[i];
+        if (via[to] >= 0) {
+            complete = crossEdgeOpen(crossEdges[via[to]], closed);
+            result.path.push_back(boundary.ids[to]);
+            result.totalDistance += crossEdges[via[to]].distance;
+        } else {
+            complete = append(partitions[boundary.partition[from]].graph->findShortestPath(
+                boundary.ids[from], boundary.ids[to]));
+        }
+    }
+    complete = complete && append(endGraph.findShortestPath(boundary.ids[route.back()], end));
+    
+    if (!complete) {
+        // A region changed under the overlay
+        result.path.clear();
+        result.totalDistance = 0;
+        return false;
+    }
+    result.approximate = true;
+    return true;
+}
+
+
+CSRGraph::PathResult PartitionedGraph::findPathBFS(const std::string& start, const std::string& end,
+                                                   const CSRGraph::StepCallback& onStep) const {
+    if (!sameRegion(start, end)) {
+        return CSRGraph::PathResult();
+    }
+    return partitionOf(start)->findPathBFS(start, end, onStep);
+}
+
+CSRGraph::HopResult PartitionedGraph::findHopCount(const std::string& start, const std::string& end) const {
+    int startPartition = partitionIndex(start);
+    int endPartition = end.empty() ? -1 : partitionIndex(end);
+    if (startPartition < 0 || (!end.empty() && endPartition < 0)) {
+        return CSRGraph::HopResult();
+    }
+    if (partitions.size() == 1) {
+        return partitions[0].graph->findHopCount(start, end);
+    }
+    
+    ScopedTimer timer("search");
+    CSRGraph::HopResult result;
+    std::vector<CSRGraph::HopSearch> searches;
+    searches.reserve(partitions.size());
+    for (const auto& partition : partitions) {
+        searches.emplace_back(*partition.graph);
+        result.totalNodes += searches.back().totalNodes();
+    }
+    // Each region watches the ends of its cross edges, then the end node
+    for (size_t p = 0; p < partitions.size(); ++p) {
+        for (const auto& crossing : crossingEnds[p]) {
+            searches[p].watch(crossing.id);
+        }
+    }
+    if (!searches[startPartition].start(start) || (!end.empty() && !searches[endPartition].watch(end))) {
+        return result;
+    }
+    
+    // All regions advance a level at a time; a cross edge reached at one
+    // level seeds the node across it into the next (the searches already
+    // skip disabled nodes). Airports other than the start are reached but
+    // never flown from. Reaching the end caps the count at its level, as
+    // within one region.
+    auto closed = closedAreas();
+    std::vector<size_t> watchedReached;
+    std::vector<const CrossingEnd::Link*> carried;
+    for (int level = 0; result.hops < 0; ++level) {
+        bool finished = true;
+        carried.clear();
+        for (size_t p = 0; p < searches.size(); ++p) {
+            if (searches[p].finished()) continue;
+            finished = false;
+            
+            watchedReached.clear();
+            result.reachableNodes += searches[p].advance(watchedReached);
+            for (size_t watched : watchedReached) {
+                if (watched == crossingEnds[p].size()) {
+                    result.hops = level;
+                    continue;
+                }
+                const CrossingEnd& crossing = crossingEnds[p][watched];
+                if (crossing.airport && !(static_cast<int>(p) == startPartition && crossing.id == start)) continue;
+                for (const auto& link : crossing.links) {
+                    if (!crossesClosedArea(crossEdges[link.edge], closed)) {
+                        carried.push_back(&link);
+                    }
+                }
+            }
+        }
+        if (finished) break;
+        
+        for (const auto* link : carried) {
+            searches[link->partition].seedWatched(link->end);
+        }
+    }
+    return result;
+}
+
+void PartitionedGraph::writeGraphVisualizationData(JsonWriter& writer) const {
+    writer.beginObject();
+    
+    writer.key("nodes").beginArray();
+    for (const auto& partition : partitions) {
+        partition.graph->writeVisualizationNodes(writer);
+    }
+    writer.endArray();
+    
+    writer.key("edges").beginArray();
+    for (const auto& partition : partitions) {
+        partition.graph->writeVisualizationEdges(writer);
+    }
+    
+    // Open cross-region edges, listed both ways like the regions' own edges
+    auto closed = closedAreas();
+    for (const auto& edge : crossEdges) {
+        if (!crossEdgeOpen(edge, closed)) continue;
+        for (bool forward : {true, false}) {
+            writer.beginObject();
+            writer.key("from").value(forward ? edge.from : edge.to);
+            writer.key("to").value(forward ? edge.to : edge.from);
+            writer.key("distance").value(edge.distance);
+            writer.endObject();
+        }
+    }
+    writer.endArray();
+    
+    writer.endObject();
+}
+
+bool PartitionedGraph::disableNode(const std::string& id) {
+    int index = partitionIndex(id);
+    if (index < 0 || !partitions[index].graph->disableNode(id)) {
+        return false;
+    }
+    markEdited(index);
+    return true;
+}
+
+bool PartitionedGraph::enableNode(const std::string& id) {
+    int index = partitionIndex(id);
+    if (index < 0 || !partitions[index].graph->enableNode(id)) {
+        return false;
+    }
+    markEdited(index);
+    return true;
+}
+
+bool PartitionedGraph::addTemporaryWaypoint(std::shared_ptr<Waypoint> waypoint) {
+    if (partitions.empty() || getNode(waypoint->getId())) {
+        return false;
+    }
+    
+    Coordinates coords = waypoint->getCoordinates();
+    int target = 0;
+    for (size_t i = 0; i < partitions.size(); ++i) {
+        const Partition& partition = partitions[i];
+        if (partition.region == waypoint->getCountryCode()) {
+            target = static_cast<int>(i);
+            break;
+        }
+        if (coords.latitude >= partition.minLat && coords.latitude <= partition.maxLat &&
+            coords.longitude >= partition.minLng && coords.longitude <= partition.maxLng) {
+            target = static_cast<int>(i);
+        }
+    }
+    
+    if (!partitions[target].graph->addTemporaryWaypoint(waypoint)) {
+        return false;
+    }
+    markEdited(target);
+    return true;
+}
+
+size_t PartitionedGraph::closeAirspace(const std::vector<Coordinates>& polygon) {
+    size_t closed = 0;
+    for (const auto& partition : partitions) {
+        closed += partition.graph->closeAirspace(polygon);
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(editMutex);
+        closedAirspace.emplace_back(polygon);
+    }
+    markEdited(-1);
+    return closed;
+}
+
+void PartitionedGraph::compact() {
+    for (const auto& partition : partitions) {
+        partition.graph->compact();
+    }
+}
+
+CSRGraph::EditStats PartitionedGraph::getEditStats() const {
+    CSRGraph::EditStats total;
+    for (const auto& partition : partitions) {
+        auto stats = partition.graph->getEditStats();
+        total.disabledNodes += stats.disabledNodes;
+        total.temporaryNodes += stats.temporaryNodes;
+        total.maskedEdges += stats.maskedEdges;
+        total.extraEdges += stats.extraEdges;
+    }
+    return total;
+}
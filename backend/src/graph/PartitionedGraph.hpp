@@ -0,0 +1,147 @@
+#pragma once
+#include "CSRGraph.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Several regional CSRGraphs joined by a small boundary overlay. Routes inside
+// one region search only that region. Cross-border routes search the start and
+// end regions out to their boundary nodes, then the overlay in between, whose
+// edges are portal edges between regions plus shortcuts through each region.
+// Portals thin the edges between two regions to the shortest crossing per
+// pair of grid cells across the border, so the overlay grows with border
+// length rather than with the link range. Cross-border routes are therefore
+// approximate: a crossing dropped by the thinning may have been slightly
+// shorter, and such results are flagged as approximate.
+class PartitionedGraph {
+public:
+    void addPartition(const std::string& region, std::shared_ptr<CSRGraph> graph);
+    
+    // Find the edges between regions (in nautical miles); call once after all
+    // partitions are added
+    void connectPartitions(double maxDistance);
+    
+    // Region graph holding a node; ids repeated across regions resolve to the
+    // region added first
+    std::shared_ptr<CSRGraph> partitionOf(const std::string& id) const;
+    bool sameRegion(const std::string& a, const std::string& b) const;
+    std::shared_ptr<Node> getNode(const std::string& id) const;
+    
+    // Dijkstra and hop counts work across regions. BFS is limited to a single
+    // region and returns an empty result otherwise.
+    CSRGraph::PathResult findPathDijkstra(const std::string& start, const std::string& end,
+                                          const CSRGraph::StepCallback& onStep = nullptr) const;
+    CSRGraph::PathResult findPathBFS(const std::string& start, const std::string& end,
+                                     const CSRGraph::StepCallback& onStep = nullptr) const;
+    CSRGraph::HopResult findHopCount(const std::string& start, const std::string& end) const;
+    
+    // Write nodes and edges of every region plus the edges between them
+    void writeGraphVisualizationData(JsonWriter& writer) const;
+    
+    // Edits go to the region owning the node and mark the overlay for rebuilding
+    bool disableNode(const std::string& id);
+    bool enableNode(const std::string& id);
+    // Added to the region matching its country code, else the one whose bounds contain it
+    bool addTemporaryWaypoint(std::shared_ptr<Waypoint> waypoint);
+    size_t closeAirspace(const std::vector<Coordinates>& polygon);
+    void compact();
+    CSRGraph::EditStats getEditStats() const;
+
+private:
+    struct Partition {
+        std::string region;
+        std::shared_ptr<CSRGraph> graph;
+        double minLat, maxLat, minLng, maxLng;
+    };
+    
+    struct CrossEdge {
+        int fromPartition;
+        int toPartition;
+        std::string from;
+        std::string to;
+        Coordinates fromCoords;
+        Coordinates toCoords;
+        double distance;
+        bool airportEnded;  // either end is an airport
+    };
+    
+    // Boundary nodes are the ends of the portal edges between regions. An edge
+    // between nodes of the same region is a shortcut through that region.
+    struct Overlay {
+        struct Edge {
+            int to;
+            double distance;
+            int cross;  // index into crossEdges, or -1 for a shortcut
+        };
+        uint64_t revision = 0;  // editRevision it reflects
+        std::vector<int> partition;
+        std::vector<std::string> ids;
+        // Airports only start or end a route, never pass one through
+        std::vector<char> airport;
+        std::vector<std::vector<Edge>> edges;
+        std::vector<std::vector<int>> byPartition;
+    };
+    
+    // Distances through one region between its boundary nodes, reused until
+    // the region is edited or its boundary set changes
+    struct RegionShortcuts {
+        uint64_t revision;
+        std::vector<std::string> boundary;
+        std::vector<std::vector<double>> distances;  // infinity where unreachable
+    };
+    
+    std::vector<Partition> partitions;
+    std::unordered_map<std::string, int> nodePartition;
+    // Every edge between regions within range; fixed after connectPartitions
+    std::vector<CrossEdge> crossEdges;
+    
+    // Ends of the cross edges in each region, each with its cross edges and
+    // the ends across them
+    struct CrossingEnd {
+        struct Link {
+            size_t edge;  // index into crossEdges
+            int partition;
+            size_t end;   // index into that region's crossingEnds
+        };
+        std::string id;
+        bool airport;
+        std::vector<Link> links;
+    };
+    std::vector<std::vector<CrossingEnd>> crossingEnds;
+    
+    // Edits only bump revisions; the overlay catches up on the next
+    // cross-region query. Guards regionRevisions and closedAirspace.
+    mutable std::mutex editMutex;
+    std::atomic<uint64_t> editRevision{0};
+    std::vector<uint64_t> regionRevisions;
+    std::vector<GraphOverlay::ClosedArea> closedAirspace;
+    
+    // One rebuild at a time; guards shortcutCache
+    mutable std::mutex rebuildMutex;
+    mutable std::vector<std::shared_ptr<const RegionShortcuts>> shortcutCache;
+    // Latest overlay, read and replaced with std::atomic_load/atomic_store
+    mutable std::shared_ptr<const Overlay> overlay;
+    
+    int partitionIndex(const std::string& id) const;
+    // Overlay for the current edits. With allowStale, a caller arriving while
+    // another thread rebuilds gets the previous overlay instead of waiting.
+    std::shared_ptr<const Overlay> currentOverlay(bool allowStale) const;
+    // rebuildMutex must be held
+    std::shared_ptr<const Overlay> buildOverlay() const;
+    std::shared_ptr<const RegionShortcuts> regionShortcuts(int partition, uint64_t revision,
+                                                           std::vector<std::string> boundary) const;
+    std::vector<GraphOverlay::ClosedArea> closedAreas() const;
+    bool crossEdgeOpen(const CrossEdge& edge, const std::vector<GraphOverlay::ClosedArea>& closed) const;
+    static bool crossesClosedArea(const CrossEdge& edge, const std::vector<GraphOverlay::ClosedArea>& closed);
+    // Record an edit to one region, or to all of them with -1
+    void markEdited(int partition);
+    // False if no route was found, or if the route no longer expands on the
+    // current regions because they were edited after the overlay was built
+    bool searchOverlay(const Overlay& boundary, int startPartition, int endPartition,
+                       const std::string& start, const std::string& end,
+                       const CSRGraph::StepCallback& onStep, CSRGraph::PathResult& result) const;
+};
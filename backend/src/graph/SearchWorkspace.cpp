@@ -0,0 +1,25 @@
+#include "SearchWorkspace.hpp"
+#include <algorithm>
+
+void SearchWorkspace::reset(size_t nodeCount) {
+    if (stamp.size() < nodeCount) {
+        // New slots get stamp 0, which never matches a live generation
+        dist.resize(nodeCount);
+        prev.resize(nodeCount);
+        stamp.resize(nodeCount, 0);
+        visitedStamp.resize(nodeCount, 0);
+    }
+    
+    if (++generation == 0) {
+        // Stamps wrapped around; clear them once so stale entries can't match
+        std::fill(stamp.begin(), stamp.end(), 0);
+        std::fill(visitedStamp.begin(), visitedStamp.end(), 0);
+        generation = 1;
+    }
+    
+    reachedNodes.clear();
+    visitedNodes.clear();
+    heap.clear();
+    queue.clear();
+    changed.clear();
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Scratch state for one search over node indices, reused across queries.
+// Entries only count when their stamp matches the current generation, so
+// starting a search is O(1) and the cost stays proportional to the nodes
+// the search actually touches.
+class SearchWorkspace {
+public:
+    static constexpr double INF = std::numeric_limits<double>::infinity();
+    
+    // Start a new search over a graph with nodeCount nodes
+    void reset(size_t nodeCount);
+    
+    bool reached(int node) const { return stamp[node] == generation; }
+    double distance(int node) const { return reached(node) ? dist[node] : INF; }
+    int previous(int node) const { return reached(node) ? prev[node] : -1; }
+    
+    // Record a tentative distance and predecessor for a node
+    void relax(int node, double distance, int previousNode) {
+        if (stamp[node] != generation) {
+            stamp[node] = generation;
+            reachedNodes.push_back(node);
+        }
+        dist[node] = distance;
+        prev[node] = previousNode;
+    }
+    
+    bool isVisited(int node) const { return visitedStamp[node] == generation; }
+    void markVisited(int node) {
+        visitedStamp[node] = generation;
+        visitedNodes.push_back(node);
+    }
+    
+    // Nodes touched by the current search, in the order they were first seen
+    const std::vector<int>& reachedOrder() const { return reachedNodes; }
+    const std::vector<int>& visitedOrder() const { return visitedNodes; }
+    
+    // Reusable container storage: a min-heap for Dijkstra, a FIFO for BFS,
+    // and the nodes relaxed since the last streamed step
+    std::vector<std::pair<double, int>> heap;
+    std::vector<int> queue;
+    std::vector<int> changed;
+
+private:
+    std::vector<double> dist;
+    std::vector<int> prev;
+    std::vector<uint32_t> stamp;
+    std::vector<uint32_t> visitedStamp;
+    std::vector<int> reachedNodes;
+    std::vector<int> visitedNodes;
+    uint32_t generation = 0;
+};
@@ -1,19 +1,39 @@
 // main.cpp
 #include "server/Server.hpp"
 #include "utils/DataLoader.hpp"
+#include "utils/Trace.hpp"
+#include <cstdlib>
 #include <iostream>
+#include <string>
+#include <vector>
 
-int main() {
+int main(int argc, char* argv[]) {
     try {
-        // Load data
-        auto waypoints = DataLoader::loadWaypoints("data/waypoints.csv", "MA");
-        auto airports = DataLoader::loadAirports("data/airports.json", "MA");
+        // Record spans for /api/trace from startup if requested
+        if (std::getenv("AVIATION_TRACE")) {
+            Tracer::setEnabled(true);
+        }
         
-        std::cout << "Loaded " << waypoints.size() << " waypoints and "
-                  << airports.size() << " airports for Morocco" << std::endl;
+        // Regions to load, one partition per country code (Morocco by default)
+        std::vector<std::string> regions;
+        for (int i = 1; i < argc; ++i) {
+            regions.push_back(argv[i]);
+        }
+        if (regions.empty()) {
+            regions.push_back("MA");
+        }
+        
+        // Load data, reading each file once for all regions
+        auto waypoints = DataLoader::loadWaypoints("data/waypoints.csv", regions);
+        auto airports = DataLoader::loadAirports("data/airports.json", regions);
+        
+        for (const auto& region : regions) {
+            std::cout << "Loaded " << waypoints[region].size() << " waypoints and "
+                      << airports[region].size() << " airports for " << region << std::endl;
+        }
         
         // Build graph (connect nodes within 100 nautical miles)
-        auto graph = DataLoader::buildGraph(waypoints, airports, 100.0);
+        auto graph = DataLoader::buildPartitionedGraph(regions, waypoints, airports, 100.0);
         
         // Start server
         Server server("http://localhost:3001", graph);
@@ -1,7 +1,24 @@
 #include "Server.hpp"
+#include <chrono>
 #include <iostream>
+#include <stdexcept>
+#include <thread>
 
-Server::Server(const std::string& url, std::shared_ptr<CSRGraph> graph)
+namespace {
+
+// Streamed output allowed to queue up before the search waits for the client
+constexpr size_t STREAM_BUFFER_LIMIT = 256 * 1024;
+// How long a client may stop reading before its search is abandoned
+constexpr auto STREAM_STALL_TIMEOUT = std::chrono::seconds(30);
+
+// Thrown from a step callback to abandon a search nobody is reading
+struct StreamClosed : std::runtime_error {
+    StreamClosed() : std::runtime_error("Stream closed by client") {}
+};
+
+} // namespace
+
+Server::Server(const std::string& url, std::shared_ptr<PartitionedGraph> graph)
     : listener(url), graph(graph) {
     
     listener.support(methods::GET, std::bind(&Server::handleGet, this, std::placeholders::_1));
@@ -43,31 +60,78 @@ void Server::handleOptions(http_request request) {
     setupCORS(request);
 }
 
-void Server::sendJsonResponse(const http_request& request, const json::value& response) {
+JsonWriter& Server::responseWriter() {
+    thread_local JsonWriter writer;
+    writer.clear();
+    return writer;
+}
+
+void Server::addTimingHeaders(http_response& response) {
+    // Phases timed so far by the request's trace, if it has one
+    RequestTrace* trace = RequestTrace::current();
+    if (trace) {
+        response.headers().add(U("Server-Timing"), utility::conversions::to_string_t(trace->serverTimingHeader()));
+        response.headers().add(U("Timing-Allow-Origin"), U("*"));
+    }
+}
+
+void Server::sendJsonResponse(const http_request& request, JsonWriter& response) {
     http_response res(status_codes::OK);
     res.headers().add(U("Access-Control-Allow-Origin"), U("*"));
-    res.headers().add(U("Content-Type"), U("application/json"));
-    res.set_body(response);
+    addTimingHeaders(res);
+    res.set_body(response.take(), "application/json");
     request.reply(res);
 }
 
 void Server::sendErrorResponse(const http_request& request, const std::string& error, status_code code) {
-    json::value response;
-    response[U("error")] = json::value::string(utility::conversions::to_string_t(error));
+    JsonWriter& response = responseWriter();
+    response.beginObject().key("error").value(error).endObject();
     
     http_response res(code);
     res.headers().add(U("Access-Control-Allow-Origin"), U("*"));
-    res.headers().add(U("Content-Type"), U("application/json"));
-    res.set_body(response);
+    addTimingHeaders(res);
+    res.set_body(response.take(), "application/json");
     request.reply(res);
 }
 
+void Server::writeStreamMessage(concurrency::streams::producer_consumer_buffer<uint8_t>& buffer,
+                                const JsonWriter& message) {
+    // Includes any wait for the client to catch up
+    ScopedTimer timer("send");
+    
+    // One JSON document per line (NDJSON); wait so the writer can be reused
+    static const uint8_t newline = '\n';
+    const std::string& line = message.str();
+    buffer.putn_nocopy(reinterpret_cast<const uint8_t*>(line.data()), line.size()).wait();
+    buffer.putn_nocopy(&newline, 1).wait();
+    
+    // The buffer grows without bound, so hold the search back until the
+    // client has drained it below the limit
+    auto deadline = std::chrono::steady_clock::now() + STREAM_STALL_TIMEOUT;
+    while (buffer.in_avail() > STREAM_BUFFER_LIMIT) {
+        if (!buffer.can_read() || std::chrono::steady_clock::now() > deadline) {
+            throw StreamClosed();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void Server::writeEditStats(JsonWriter& writer, const CSRGraph::EditStats& stats) {
+    writer.key("disabledNodes").value(stats.disabledNodes);
+    writer.key("temporaryNodes").value(stats.temporaryNodes);
+    writer.key("maskedEdges").value(stats.maskedEdges);
+    writer.key("extraEdges").value(stats.extraEdges);
+}
+
 void Server::handleGet(http_request request) {
     auto path = request.relative_uri().path();
     
     if (path == U("/api/graph")) {
         getGraphData(request);
     }
+    else if (path == U("/api/trace")) {
+        getTrace(request);
+    }
     else {
         sendErrorResponse(request, "Endpoint not found", status_codes::NotFound);
     }
@@ -79,6 +143,22 @@ void Server::handlePost(http_request request) {
     if (path == U("/api/find-path")) {
         findPath(request);
     }
+    else if (path == U("/api/find-path/stream")) {
+        findPathStream(request);
+    }
+    else if (path == U("/api/hop-count")) {
+        hopCount(request);
+    }
+    else if (path == U("/api/trace")) {
+        setTracing(request);
+    }
+    else if (path == U("/api/graph/compact")) {
+        compactGraph(request);
+    }
+    else if (path == U("/api/graph/disable-node") || path == U("/api/graph/enable-node") ||
+             path == U("/api/graph/waypoints") || path == U("/api/graph/close-airspace")) {
+        editGraph(request, path);
+    }
     else {
         sendErrorResponse(request, "Endpoint not found", status_codes::NotFound);
     }
@@ -86,7 +166,14 @@ void Server::handlePost(http_request request) {
 
 void Server::getGraphData(http_request request) {
     try {
-        auto graphData = graph->getGraphVisualizationData();
+        RequestTrace trace;
+        RequestTrace::Scope scope(trace);
+        
+        JsonWriter& graphData = responseWriter();
+        {
+            ScopedTimer timer("serialize");
+            graph->writeGraphVisualizationData(graphData);
+        }
         sendJsonResponse(request, graphData);
     }
     catch (const std::exception& e) {
@@ -96,8 +183,12 @@ void Server::getGraphData(http_request request) {
 
 void Server::findPath(http_request request) {
     try {
+        auto received = RequestTrace::Clock::now();
         request.extract_json()
-        .then([this, request](json::value body) {
+        .then([this, request, received](json::value body) {
+            RequestTrace trace;
+            RequestTrace::Scope scope(trace);
+            trace.addSince("receive", received);
             try {
                 // Extract parameters
                 auto startId = utility::conversions::to_utf8string(body[U("start")].as_string());
@@ -110,6 +201,13 @@ void Server::findPath(http_request request) {
                     return;
                 }
                 
+                // BFS runs within one region; only Dijkstra crosses borders
+                if (algorithm == "bfs" && !graph->sameRegion(startId, endId)) {
+                    sendErrorResponse(request, "BFS requires start and end in the same region",
+                                      status_codes::BadRequest);
+                    return;
+                }
+                
                 CSRGraph::PathResult result;
                 if (algorithm == "dijkstra") {
                     result = graph->findPathDijkstra(startId, endId);
@@ -122,7 +220,272 @@ void Server::findPath(http_request request) {
                     return;
                 }
                 
-                sendJsonResponse(request, result.toJson());
+                JsonWriter& response = responseWriter();
+                {
+                    ScopedTimer timer("serialize");
+                    result.writeJson(response);
+                }
+                sendJsonResponse(request, response);
+            }
+            catch (const json::json_exception&) {
+                sendErrorResponse(request, "Invalid request body", status_codes::BadRequest);
+            }
+        })
+        .wait();
+    }
+    catch (const std::exception& e) {
+        sendErrorResponse(request, e.what(), status_codes::InternalError);
+    }
+}
+
+void Server::findPathStream(http_request request) {
+    try {
+        auto received = RequestTrace::Clock::now();
+        request.extract_json()
+        .then([this, request, received](json::value body) {
+            RequestTrace trace;
+            RequestTrace::Scope scope(trace);
+            trace.addSince("receive", received);
+            
+            std::string startId, endId, algorithm;
+            try {
+                startId = utility::conversions::to_utf8string(body[U("start")].as_string());
+                endId = utility::conversions::to_utf8string(body[U("end")].as_string());
+                algorithm = utility::conversions::to_utf8string(body[U("algorithm")].as_string());
+            }
+            catch (const json::json_exception&) {
+                sendErrorResponse(request, "Invalid request body", status_codes::BadRequest);
+                return;
+            }
+            
+            // Validate before committing to a streamed 200 response
+            if (!graph->getNode(startId) || !graph->getNode(endId)) {
+                sendErrorResponse(request, "Invalid start or end node", status_codes::BadRequest);
+                return;
+            }
+            if (algorithm != "dijkstra" && algorithm != "bfs") {
+                sendErrorResponse(request, "Invalid algorithm specified", status_codes::BadRequest);
+                return;
+            }
+            if (algorithm == "bfs" && !graph->sameRegion(startId, endId)) {
+                sendErrorResponse(request, "BFS requires start and end in the same region",
+                                  status_codes::BadRequest);
+                return;
+            }
+            
+            // Without a Content-Length the body is sent chunked as it is produced
+            concurrency::streams::producer_consumer_buffer<uint8_t> buffer;
+            http_response res(status_codes::OK);
+            res.headers().add(U("Access-Control-Allow-Origin"), U("*"));
+            res.headers().add(U("Cache-Control"), U("no-cache"));
+            res.set_body(buffer.create_istream(), U("application/x-ndjson"));
+            request.reply(res);
+            
+            // The 200 has been sent; from here on failures are reported in the stream
+            try {
+                JsonWriter& message = responseWriter();
+                
+                // Streamed steps list only what changed since the one before;
+                // the client accumulates them into full steps
+                auto onStep = [&](const CSRGraph::AlgorithmStep& step) {
+                    {
+                        ScopedTimer timer("serialize");
+                        message.clear();
+                        message.beginObject().key("type").value("step").key("step");
+                        step.writeJson(message);
+                        message.endObject();
+                    }
+                    writeStreamMessage(buffer, message);
+                };
+                
+                CSRGraph::PathResult result = algorithm == "dijkstra"
+                    ? graph->findPathDijkstra(startId, endId, onStep)
+                    : graph->findPathBFS(startId, endId, onStep);
+                
+                // The final message carries the path; its steps were already streamed.
+                // Headers went out before the search, so timings travel in the body.
+                message.clear();
+                message.beginObject().key("type").value("result");
+                result.writeJsonFields(message, false);
+                message.key("timing");
+                trace.writeJson(message);
+                message.endObject();
+                writeStreamMessage(buffer, message);
+            }
+            catch (const StreamClosed&) {
+                // Nobody is reading; just end the stream
+            }
+            catch (const std::exception& e) {
+                try {
+                    JsonWriter& message = responseWriter();
+                    message.beginObject().key("type").value("error").key("error").value(e.what()).endObject();
+                    writeStreamMessage(buffer, message);
+                }
+                catch (const std::exception&) {
+                    // The client is gone as well
+                }
+            }
+            try {
+                buffer.close(std::ios_base::out).wait();
+            }
+            catch (const std::exception&) {
+                // Already replied; there is no one left to tell
+            }
+        })
+        .wait();
+    }
+    catch (const std::exception& e) {
+        sendErrorResponse(request, e.what(), status_codes::InternalError);
+    }
+}
+
+void Server::hopCount(http_request request) {
+    try {
+        auto received = RequestTrace::Clock::now();
+        request.extract_json()
+        .then([this, request, received](json::value body) {
+            RequestTrace trace;
+            RequestTrace::Scope scope(trace);
+            trace.addSince("receive", received);
+            try {
+                // "end" is optional; without it the whole reachable set is explored
+                auto startId = utility::conversions::to_utf8string(body[U("start")].as_string());
+                std::string endId;
+                if (body.has_field(U("end"))) {
+                    endId = utility::conversions::to_utf8string(body[U("end")].as_string());
+                }
+                
+                if (!graph->getNode(startId) || (!endId.empty() && !graph->getNode(endId))) {
+                    sendErrorResponse(request, "Invalid start or end node", status_codes::BadRequest);
+                    return;
+                }
+                CSRGraph::HopResult result = graph->findHopCount(startId, endId);
+                
+                JsonWriter& response = responseWriter();
+                response.beginObject();
+                response.key("hops");
+                if (result.hops >= 0) {
+                    response.value(result.hops);
+                } else {
+                    response.null();
+                }
+                response.key("reachableNodes").value(result.reachableNodes);
+                response.key("totalNodes").value(result.totalNodes);
+                response.endObject();
+                sendJsonResponse(request, response);
+            }
+            catch (const json::json_exception&) {
+                sendErrorResponse(request, "Invalid request body", status_codes::BadRequest);
+            }
+        })
+        .wait();
+    }
+    catch (const std::exception& e) {
+        sendErrorResponse(request, e.what(), status_codes::InternalError);
+    }
+}
+
+void Server::editGraph(http_request request, const utility::string_t& path) {
+    try {
+        request.extract_json()
+        .then([this, request, path](json::value body) {
+            try {
+                size_t closedEdges = 0;
+                
+                if (path == U("/api/graph/close-airspace")) {
+                    std::vector<Coordinates> polygon;
+                    for (const auto& vertex : body[U("polygon")].as_array()) {
+                        polygon.push_back({vertex.at(U("lat")).as_double(), vertex.at(U("lng")).as_double()});
+                    }
+                    if (polygon.size() < 3) {
+                        sendErrorResponse(request, "Polygon needs at least 3 vertices", status_codes::BadRequest);
+                        return;
+                    }
+                    closedEdges = graph->closeAirspace(polygon);
+                }
+                else if (path == U("/api/graph/waypoints")) {
+                    auto id = utility::conversions::to_utf8string(body[U("id")].as_string());
+                    Coordinates coords{body[U("lat")].as_double(), body[U("lng")].as_double()};
+                    std::string countryCode, countryName;
+                    if (body.has_field(U("countryCode"))) {
+                        countryCode = utility::conversions::to_utf8string(body[U("countryCode")].as_string());
+                    }
+                    if (body.has_field(U("countryName"))) {
+                        countryName = utility::conversions::to_utf8string(body[U("countryName")].as_string());
+                    }
+                    
+                    auto waypoint = std::make_shared<Waypoint>(id, countryCode, countryName, coords);
+                    if (!graph->addTemporaryWaypoint(waypoint)) {
+                        sendErrorResponse(request, "Node already exists", status_codes::Conflict);
+                        return;
+                    }
+                }
+                else {
+                    auto id = utility::conversions::to_utf8string(body[U("id")].as_string());
+                    bool found = path == U("/api/graph/disable-node") ? graph->disableNode(id)
+                                                                      : graph->enableNode(id);
+                    if (!found) {
+                        sendErrorResponse(request, "Invalid node", status_codes::BadRequest);
+                        return;
+                    }
+                }
+                
+                JsonWriter& response = responseWriter();
+                response.beginObject();
+                if (path == U("/api/graph/close-airspace")) {
+                    response.key("closedEdges").value(closedEdges);
+                }
+                writeEditStats(response, graph->getEditStats());
+                response.endObject();
+                sendJsonResponse(request, response);
+            }
+            catch (const json::json_exception&) {
+                sendErrorResponse(request, "Invalid request body", status_codes::BadRequest);
+            }
+        })
+        .wait();
+    }
+    catch (const std::exception& e) {
+        sendErrorResponse(request, e.what(), status_codes::InternalError);
+    }
+}
+
+void Server::compactGraph(http_request request) {
+    try {
+        graph->compact();
+        
+        JsonWriter& response = responseWriter();
+        response.beginObject();
+        writeEditStats(response, graph->getEditStats());
+        response.endObject();
+        sendJsonResponse(request, response);
+    }
+    catch (const std::exception& e) {
+        sendErrorResponse(request, e.what(), status_codes::InternalError);
+    }
+}
+
+void Server::getTrace(http_request request) {
+    try {
+        JsonWriter& response = responseWriter();
+        Tracer::writeChromeTrace(response);
+        sendJsonResponse(request, response);
+    }
+    catch (const std::exception& e) {
+        sendErrorResponse(request, e.what(), status_codes::InternalError);
+    }
+}
+
+void Server::setTracing(http_request request) {
+    try {
+        request.extract_json()
+        .then([this, request](json::value body) {
+            try {
+                Tracer::setEnabled(body[U("enabled")].as_bool());
+                
+                JsonWriter& response = responseWriter();
+                response.beginObject().key("enabled").value(Tracer::isEnabled()).endObject();
+                sendJsonResponse(request, response);
             }
             catch (const json::json_exception&) {
                 sendErrorResponse(request, "Invalid request body", status_codes::BadRequest);
@@ -1,6 +1,9 @@
 #pragma once
-#include "../graph/CSRGraph.hpp"
+#include "../graph/PartitionedGraph.hpp"
+#include "../utils/JsonWriter.hpp"
+#include "../utils/Trace.hpp"
 #include <cpprest/http_listener.h>
+#include <cpprest/producerconsumerstream.h>
 #include <memory>
 
 using namespace web;
@@ -9,14 +12,14 @@ using namespace web::http::experimental::listener;
 
 class Server {
 public:
-    Server(const std::string& url, std::shared_ptr<CSRGraph> graph);
+    Server(const std::string& url, std::shared_ptr<PartitionedGraph> graph);
     
     void start();
     void stop();
 
 private:
     http_listener listener;
-    std::shared_ptr<CSRGraph> graph;
+    std::shared_ptr<PartitionedGraph> graph;
     
     // Request handlers
     void handleGet(http_request request);
@@ -26,11 +29,24 @@ private:
     // Specific endpoint handlers
     void getGraphData(http_request request);
     void findPath(http_request request);
+    void findPathStream(http_request request);
+    void hopCount(http_request request);
+    void editGraph(http_request request, const utility::string_t& path);
+    void compactGraph(http_request request);
+    void getTrace(http_request request);
+    void setTracing(http_request request);
     
     // Helper methods
     void setupCORS(http_request& request);
-    void sendJsonResponse(const http_request& request, const json::value& response);
+    void addTimingHeaders(http_response& response);
+    void writeEditStats(JsonWriter& writer, const CSRGraph::EditStats& stats);
+    void sendJsonResponse(const http_request& request, JsonWriter& response);
     void sendErrorResponse(const http_request& request, const std::string& error, status_code code);
+    void writeStreamMessage(concurrency::streams::producer_consumer_buffer<uint8_t>& buffer,
+                            const JsonWriter& message);
+    
+    // Per-thread output buffer, cleared but not shrunk between responses
+    static JsonWriter& responseWriter();
 };
 
 
@@ -22,7 +22,17 @@ std::vector<std::string> DataLoader::splitCSV(const std::string& line) {
 std::vector<std::shared_ptr<Waypoint>> DataLoader::loadWaypoints(
     const std::string& filename, const std::string& countryCode) {
     
-    std::vector<std::shared_ptr<Waypoint>> waypoints;
+    return std::move(loadWaypoints(filename, std::vector<std::string>{countryCode})[countryCode]);
+}
+
+DataLoader::WaypointsByCountry DataLoader::loadWaypoints(
+    const std::string& filename, const std::vector<std::string>& countryCodes) {
+    
+    WaypointsByCountry waypoints;
+    for (const auto& countryCode : countryCodes) {
+        waypoints[countryCode];
+    }
+    
     std::ifstream file(filename);
     std::string line;
     
@@ -31,9 +41,11 @@ std::vector<std::shared_ptr<Waypoint>> DataLoader::loadWaypoints(
     
     while (std::getline(file, line)) {
         auto parts = splitCSV(line);
-        if (parts.size() >= 5 && parts[0] == countryCode) {
+        if (parts.size() < 5) continue;
+        auto bucket = waypoints.find(parts[0]);
+        if (bucket != waypoints.end()) {
             Coordinates coords{std::stod(parts[3]), std::stod(parts[4])};
-            waypoints.push_back(std::make_shared<Waypoint>(
+            bucket->second.push_back(std::make_shared<Waypoint>(
                 parts[2], parts[0], parts[1], coords
             ));
         }
@@ -45,7 +57,17 @@ std::vector<std::shared_ptr<Waypoint>> DataLoader::loadWaypoints(
 std::vector<std::shared_ptr<Airport>> DataLoader::loadAirports(
     const std::string& filename, const std::string& countryCode) {
     
-    std::vector<std::shared_ptr<Airport>> airports;
+    return std::move(loadAirports(filename, std::vector<std::string>{countryCode})[countryCode]);
+}
+
+DataLoader::AirportsByCountry DataLoader::loadAirports(
+    const std::string& filename, const std::vector<std::string>& countryCodes) {
+    
+    AirportsByCountry airports;
+    for (const auto& countryCode : countryCodes) {
+        airports[countryCode];
+    }
+    
     std::ifstream file(filename);
     std::string jsonStr((std::istreambuf_iterator<char>(file)),
                         std::istreambuf_iterator<char>());
@@ -56,13 +78,14 @@ std::vector<std::shared_ptr<Airport>> DataLoader::loadAirports(
         const auto& airportData = pair.second;
         std::string country = utility::conversions::to_utf8string(airportData.at(U("country")).as_string());
         
-        if (country == countryCode) {
+        auto bucket = airports.find(country);
+        if (bucket != airports.end()) {
             Coordinates coords{
                 airportData.at(U("lat")).as_double(),
                 airportData.at(U("lon")).as_double()
             };
             
-            airports.push_back(std::make_shared<Airport>(
+            bucket->second.push_back(std::make_shared<Airport>(
                 utility::conversions::to_utf8string(pair.first),
                 utility::conversions::to_utf8string(airportData.at(U("name")).as_string()),
                 utility::conversions::to_utf8string(airportData.at(U("city")).as_string()),
@@ -96,3 +119,29 @@ std::shared_ptr<CSRGraph> DataLoader::buildGraph(
     
     return graph;
 }
+
+std::shared_ptr<PartitionedGraph> DataLoader::buildPartitionedGraph(
+    const std::vector<std::string>& countryCodes,
+    const WaypointsByCountry& waypoints,
+    const AirportsByCountry& airports,
+    double maxDistance) {
+    
+    static const std::vector<std::shared_ptr<Waypoint>> noWaypoints;
+    static const std::vector<std::shared_ptr<Airport>> noAirports;
+    
+    auto graph = std::make_shared<PartitionedGraph>();
+    
+    for (const auto& countryCode : countryCodes) {
+        auto regionWaypoints = waypoints.find(countryCode);
+        auto regionAirports = airports.find(countryCode);
+        graph->addPartition(countryCode, buildGraph(
+            regionWaypoints != waypoints.end() ? regionWaypoints->second : noWaypoints,
+            regionAirports != airports.end() ? regionAirports->second : noAirports,
+            maxDistance));
+    }
+    
+    // Link the regions with edges of the same range
+    graph->connectPartitions(maxDistance);
+    
+    return graph;
+}
@@ -1,24 +1,41 @@
 #pragma once
 #include "../graph/Node.hpp"
 #include "../graph/CSRGraph.hpp"
+#include "../graph/PartitionedGraph.hpp"
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 class DataLoader {
 public:
+    using WaypointsByCountry = std::unordered_map<std::string, std::vector<std::shared_ptr<Waypoint>>>;
+    using AirportsByCountry = std::unordered_map<std::string, std::vector<std::shared_ptr<Airport>>>;
+    
     // Load waypoints from CSV file
     static std::vector<std::shared_ptr<Waypoint>> loadWaypoints(const std::string& filename, 
                                                                const std::string& countryCode);
+    // Load waypoints for several countries in one pass over the file
+    static WaypointsByCountry loadWaypoints(const std::string& filename,
+                                            const std::vector<std::string>& countryCodes);
     
     // Load airports from JSON file
     static std::vector<std::shared_ptr<Airport>> loadAirports(const std::string& filename, 
                                                              const std::string& countryCode);
+    // Load airports for several countries in one parse of the file
+    static AirportsByCountry loadAirports(const std::string& filename,
+                                          const std::vector<std::string>& countryCodes);
     
     // Build graph from loaded data
     static std::shared_ptr<CSRGraph> buildGraph(const std::vector<std::shared_ptr<Waypoint>>& waypoints,
                                               const std::vector<std::shared_ptr<Airport>>& airports,
                                               double maxDistance);
+    
+    // Build one graph per country code and link them across borders
+    static std::shared_ptr<PartitionedGraph> buildPartitionedGraph(const std::vector<std::string>& countryCodes,
+                                                                  const WaypointsByCountry& waypoints,
+                                                                  const AirportsByCountry& airports,
+                                                                  double maxDistance);
 
 private:
     static std::vector<std::string> splitCSV(const std::string& line);
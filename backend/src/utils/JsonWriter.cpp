@@ -0,0 +1,155 @@
+#include "JsonWriter.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+void JsonWriter::clear() {
+    if (buffer.capacity() > RETAINED_CAPACITY) {
+        buffer = std::string();
+        buffer.reserve(RESERVED_CAPACITY);
+    } else {
+        buffer.clear();
+    }
+    needComma = false;
+}
+
+std::string JsonWriter::take() {
+    std::string document = std::move(buffer);
+    buffer = std::string();
+    buffer.reserve(RESERVED_CAPACITY);
+    needComma = false;
+    return document;
+}
+
+void JsonWriter::separate() {
+    if (needComma) {
+        buffer.push_back(',');
+    }
+}
+
+JsonWriter& JsonWriter::beginObject() {
+    separate();
+    buffer.push_back('{');
+    needComma = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+    buffer.push_back('}');
+    needComma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+    separate();
+    buffer.push_back('[');
+    needComma = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+    buffer.push_back(']');
+    needComma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(const std::string& name) {
+    separate();
+    appendEscaped(name.data(), name.size());
+    buffer.push_back(':');
+    needComma = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(const std::string& text) {
+    separate();
+    appendEscaped(text.data(), text.size());
+    needComma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(const char* text) {
+    separate();
+    appendEscaped(text, std::strlen(text));
+    needComma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double number) {
+    separate();
+    if (!std::isfinite(number)) {
+        // JSON has no representation for inf/nan
+        buffer.append("null");
+    } else {
+        // Shortest representation that round-trips, without going through a stream
+        char digits[32];
+        auto result = std::to_chars(digits, digits + sizeof(digits), number);
+        buffer.append(digits, result.ptr);
+    }
+    needComma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(int number) {
+    separate();
+    char digits[16];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    buffer.append(digits, result.ptr);
+    needComma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(size_t number) {
+    separate();
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    buffer.append(digits, result.ptr);
+    needComma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool flag) {
+    separate();
+    buffer.append(flag ? "true" : "false");
+    needComma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+    separate();
+    buffer.append("null");
+    needComma = true;
+    return *this;
+}
+
+void JsonWriter::appendEscaped(const char* text, size_t length) {
+    static const char hex[] = "0123456789abcdef";
+    
+    buffer.push_back('"');
+    size_t runStart = 0;
+    for (size_t i = 0; i < length; ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        
+        // Copy the clean run in one go, then the escape sequence
+        buffer.append(text + runStart, i - runStart);
+        runStart = i + 1;
+        switch (c) {
+            case '"':  buffer.append("\\\""); break;
+            case '\\': buffer.append("\\\\"); break;
+            case '\n': buffer.append("\\n"); break;
+            case '\r': buffer.append("\\r"); break;
+            case '\t': buffer.append("\\t"); break;
+            default: {
+                char escape[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+                buffer.append(escape, sizeof(escape));
+                break;
+            }
+        }
+    }
+    buffer.append(text + runStart, length - runStart);
+    buffer.push_back('"');
+}
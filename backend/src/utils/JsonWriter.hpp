@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+
+// Streaming JSON writer that appends straight into a reusable string buffer.
+// Commas are inserted automatically; callers are responsible for balancing
+// begin/end calls and for pairing every key() with exactly one value.
+class JsonWriter {
+public:
+    // Drop the contents but keep the allocated capacity for the next document,
+    // unless an unusually large one left more than is worth holding on to
+    void clear();
+    
+    const std::string& str() const { return buffer; }
+    
+    // Hand the document over without copying; the writer starts again with
+    // a modest buffer
+    std::string take();
+    
+    JsonWriter& beginObject();
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& endArray();
+    
+    JsonWriter& key(const std::string& name);
+    
+    JsonWriter& value(const std::string& text);
+    JsonWriter& value(const char* text);
+    JsonWriter& value(double number);
+    JsonWriter& value(int number);
+    JsonWriter& value(size_t number);
+    JsonWriter& value(bool flag);
+    JsonWriter& null();
+
+private:
+    // Capacity kept between documents, and the most clear() lets it keep
+    static constexpr size_t RESERVED_CAPACITY = 4096;
+    static constexpr size_t RETAINED_CAPACITY = 1 << 20;
+    
+    std::string buffer;
+    bool needComma = false;
+    
+    void separate();
+    void appendEscaped(const char* text, size_t length);
+};
@@ -0,0 +1,155 @@
+#include "Trace.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+namespace {
+
+thread_local RequestTrace* currentTrace = nullptr;
+
+// Spans kept for the Chrome trace; older ones are overwritten
+constexpr size_t TRACE_CAPACITY = 1 << 16;
+
+// Writers claim slots with a fetch_add on nextSpan. Each slot carries a
+// sequence number, odd while its span is being written and 2 * ticket + 2
+// once span number `ticket` is in place, so a dump can skip slots that are
+// mid-write or already overwritten instead of locking out the writers.
+struct Slot {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<int> thread{0};
+    std::atomic<RequestTrace::Clock::rep> start{0};
+    std::atomic<RequestTrace::Clock::rep> end{0};
+};
+
+std::mutex setupMutex;
+std::atomic<Slot*> slots{nullptr};
+std::atomic<uint64_t> nextSpan{0};
+const RequestTrace::Clock::time_point traceEpoch = RequestTrace::Clock::now();
+
+// Small stable thread numbers read better in the trace viewer than hashed ids
+int threadNumber() {
+    static std::atomic<int> nextThread{1};
+    thread_local int number = nextThread++;
+    return number;
+}
+
+} // namespace
+
+std::atomic<bool> Tracer::enabled{false};
+thread_local ScopedTimer* ScopedTimer::innermost = nullptr;
+
+RequestTrace::Scope::Scope(RequestTrace& trace) : previous(currentTrace) {
+    currentTrace = &trace;
+}
+
+RequestTrace::Scope::~Scope() {
+    currentTrace = previous;
+}
+
+RequestTrace* RequestTrace::current() {
+    return currentTrace;
+}
+
+void RequestTrace::add(const char* phase, double milliseconds) {
+    for (auto& existing : phases) {
+        if (existing.name == phase || std::strcmp(existing.name, phase) == 0) {
+            existing.milliseconds += milliseconds;
+            return;
+        }
+    }
+    phases.push_back({phase, milliseconds});
+}
+
+void RequestTrace::addSince(const char* phase, Clock::time_point start) {
+    auto end = Clock::now();
+    add(phase, std::chrono::duration<double, std::milli>(end - start).count());
+    if (Tracer::isEnabled()) {
+        Tracer::record(phase, start, end);
+    }
+}
+
+std::string RequestTrace::serverTimingHeader() const {
+    std::string header;
+    char duration[32];
+    for (const auto& phase : phases) {
+        if (!header.empty()) {
+            header.append(", ");
+        }
+        std::snprintf(duration, sizeof(duration), ";dur=%.3f", phase.milliseconds);
+        header.append(phase.name).append(duration);
+    }
+    return header;
+}
+
+void RequestTrace::writeJson(JsonWriter& writer) const {
+    writer.beginObject();
+    for (const auto& phase : phases) {
+        writer.key(phase.name).value(phase.milliseconds);
+    }
+    writer.endObject();
+}
+
+void Tracer::setEnabled(bool value) {
+    std::lock_guard<std::mutex> lock(setupMutex);
+    if (value && !slots.load(std::memory_order_relaxed)) {
+        slots.store(new Slot[TRACE_CAPACITY], std::memory_order_release);
+    }
+    enabled.store(value, std::memory_order_relaxed);
+}
+
+void Tracer::record(const char* name, RequestTrace::Clock::time_point start,
+                    RequestTrace::Clock::time_point end) {
+    Slot* ring = slots.load(std::memory_order_acquire);
+    if (!ring) return;
+    int thread = threadNumber();
+    uint64_t ticket = nextSpan.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = ring[ticket % TRACE_CAPACITY];
+    
+    slot.sequence.store(2 * ticket + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.thread.store(thread, std::memory_order_relaxed);
+    slot.start.store(start.time_since_epoch().count(), std::memory_order_relaxed);
+    slot.end.store(end.time_since_epoch().count(), std::memory_order_relaxed);
+    slot.sequence.store(2 * ticket + 2, std::memory_order_release);
+}
+
+void Tracer::writeChromeTrace(JsonWriter& writer) {
+    auto micros = [](RequestTrace::Clock::duration duration) {
+        return std::chrono::duration<double, std::micro>(duration).count();
+    };
+    
+    writer.beginObject();
+    writer.key("traceEvents").beginArray();
+    
+    // Oldest first; the ring holds the last TRACE_CAPACITY tickets
+    Slot* ring = slots.load(std::memory_order_acquire);
+    uint64_t end = ring ? nextSpan.load(std::memory_order_acquire) : 0;
+    uint64_t first = end > TRACE_CAPACITY ? end - TRACE_CAPACITY : 0;
+    for (uint64_t ticket = first; ticket < end; ++ticket) {
+        Slot& slot = ring[ticket % TRACE_CAPACITY];
+        uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != 2 * ticket + 2) continue;
+        const char* name = slot.name.load(std::memory_order_relaxed);
+        int thread = slot.thread.load(std::memory_order_relaxed);
+        RequestTrace::Clock::duration spanStart(slot.start.load(std::memory_order_relaxed));
+        RequestTrace::Clock::duration spanEnd(slot.end.load(std::memory_order_relaxed));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence) continue;
+        
+        writer.beginObject();
+        writer.key("name").value(name);
+        writer.key("ph").value("X");
+        writer.key("ts").value(micros(RequestTrace::Clock::time_point(spanStart) - traceEpoch));
+        writer.key("dur").value(micros(spanEnd - spanStart));
+        writer.key("pid").value(1);
+        writer.key("tid").value(thread);
+        writer.endObject();
+    }
+    
+    writer.endArray();
+    writer.key("displayTimeUnit").value("ms");
+    writer.endObject();
+}
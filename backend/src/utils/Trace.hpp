@@ -0,0 +1,110 @@
+#pragma once
+#include "JsonWriter.hpp"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Phase timings for one request, summed by phase name and reported back in
+// the Server-Timing response header. Phases are exclusive: time spent in a
+// nested ScopedTimer counts toward the inner phase only, so the phases add up
+// to no more than the request's total.
+class RequestTrace {
+public:
+    using Clock = std::chrono::steady_clock;
+    
+    // Makes a trace the one ScopedTimers on this thread report into
+    class Scope {
+    public:
+        explicit Scope(RequestTrace& trace);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        RequestTrace* previous;
+    };
+    
+    // Trace bound to the calling thread, or nullptr
+    static RequestTrace* current();
+    
+    // Phase names must be string literals; they are kept by pointer
+    void add(const char* phase, double milliseconds);
+    // Record a phase that began before this trace was in scope, e.g. receiving
+    // and decoding the request body
+    void addSince(const char* phase, Clock::time_point start);
+    
+    // e.g. "receive;dur=0.31, search;dur=4.20"
+    std::string serverTimingHeader() const;
+    void writeJson(JsonWriter& writer) const;
+
+private:
+    struct Phase {
+        const char* name;
+        double milliseconds;
+    };
+    std::vector<Phase> phases;
+};
+
+// Process-wide span recorder. When enabled, every ScopedTimer also lands in a
+// fixed-size ring buffer that can be dumped as Chrome trace-event JSON
+// (chrome://tracing, Perfetto). Disabled by default.
+class Tracer {
+public:
+    static void setEnabled(bool enabled);
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+    
+    static void record(const char* name, RequestTrace::Clock::time_point start,
+                       RequestTrace::Clock::time_point end);
+    static void writeChromeTrace(JsonWriter& writer);
+
+private:
+    static std::atomic<bool> enabled;
+};
+
+// Times its own scope and reports to the thread's RequestTrace and, when
+// enabled, the Tracer. With neither active it doesn't read the clock. The
+// trace gets the time minus any nested timers; Tracer spans stay inclusive,
+// as trace viewers expect.
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const char* name)
+        : name(name), trace(RequestTrace::current()), recording(Tracer::isEnabled()) {
+        if (trace) {
+            parent = innermost;
+            innermost = this;
+        }
+        if (trace || recording) {
+            start = RequestTrace::Clock::now();
+        }
+    }
+    
+    ~ScopedTimer() {
+        if (!trace && !recording) return;
+        auto end = RequestTrace::Clock::now();
+        if (trace) {
+            double total = std::chrono::duration<double, std::milli>(end - start).count();
+            trace->add(name, total - nestedMilliseconds);
+            innermost = parent;
+            if (parent && parent->trace == trace) {
+                parent->nestedMilliseconds += total;
+            }
+        }
+        if (recording) {
+            Tracer::record(name, start, end);
+        }
+    }
+    
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    const char* name;
+    RequestTrace* trace;
+    bool recording;
+    RequestTrace::Clock::time_point start;
+    ScopedTimer* parent = nullptr;
+    double nestedMilliseconds = 0;
+    
+    // Innermost timer reporting to a trace on this thread
+    static thread_local ScopedTimer* innermost;
+};
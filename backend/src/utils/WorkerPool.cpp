@@ -0,0 +1,88 @@
+#include "WorkerPool.hpp"
+#include <algorithm>
+
+struct WorkerPool::Job {
+    const std::function<void(size_t, size_t)>& fn;
+    size_t pending;  // chunks handed out and not yet finished; guarded by the pool mutex
+    std::condition_variable finished;
+};
+
+WorkerPool& WorkerPool::shared() {
+    static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+WorkerPool::WorkerPool(size_t workers) {
+    for (size_t i = 0; i < workers; ++i) {
+        threads.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::parallelFor(size_t count, size_t minChunk, const std::function<void(size_t, size_t)>& fn) {
+    size_t chunks = std::min(threads.size() + 1, (count + minChunk - 1) / minChunk);
+    if (chunks <= 1) {
+        fn(0, count);
+        return;
+    }
+    
+    // The caller takes the first chunk and queues the rest
+    size_t chunk = (count + chunks - 1) / chunks;
+    Job job{fn, 0, {}};
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t begin = chunk; begin < count; begin += chunk) {
+            tasks.push_back({&job, begin, std::min(count, begin + chunk)});
+            ++job.pending;
+        }
+    }
+    wake.notify_all();
+    fn(0, chunk);
+    
+    // Run queued chunks, this loop's or another caller's, until this loop's are done
+    std::unique_lock<std::mutex> lock(mutex);
+    while (job.pending > 0) {
+        if (tasks.empty()) {
+            job.finished.wait(lock);
+            continue;
+        }
+        Task task = tasks.front();
+        tasks.pop_front();
+        lock.unlock();
+        runTask(task);
+        lock.lock();
+    }
+}
+
+void WorkerPool::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (tasks.empty()) {
+            return;
+        }
+        Task task = tasks.front();
+        tasks.pop_front();
+        lock.unlock();
+        runTask(task);
+        lock.lock();
+    }
+}
+
+void WorkerPool::runTask(const Task& task) {
+    task.job->fn(task.begin, task.end);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--task.job->pending == 0) {
+        task.job->finished.notify_all();
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Process-wide pool of worker threads, started once, for splitting loops
+// across cores. Concurrent callers share the workers instead of each starting
+// threads of their own, and every caller runs chunks itself while it waits,
+// so a loop still finishes when all workers are busy or there are none.
+class WorkerPool {
+public:
+    // One worker per hardware thread beyond the caller's
+    static WorkerPool& shared();
+
+    explicit WorkerPool(size_t workers);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Run fn(begin, end) over [0, count) in chunks of at least minChunk;
+    // returns once every chunk has run
+    void parallelFor(size_t count, size_t minChunk, const std::function<void(size_t, size_t)>& fn);
+
+private:
+    struct Job;
+    struct Task {
+        Job* job;
+        size_t begin;
+        size_t end;
+    };
+
+    void workerLoop();
+    void runTask(const Task& task);
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Task> tasks;
+    bool stopping = false;
+    std::vector<std::thread> threads;
+};
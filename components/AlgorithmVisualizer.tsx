@@ -39,6 +39,7 @@ interface PathResult {
   path: string[];
   totalDistance: number;
   steps: AlgorithmStep[];
+  approximate?: boolean;
 }
 
 interface AlgorithmStep {
@@ -75,7 +76,7 @@ export default function AlgorithmVisualizer({
         <div className="space-y-2">
           <p className="text-sm font-medium">Current Node: {currentStep.currentNode}</p>
           <p className="text-sm">
-            Distance: {pathResult.totalDistance.toFixed(2)} nautical miles
+            Distance: {pathResult.approximate ? "~" : ""}{pathResult.totalDistance.toFixed(2)} nautical miles
           </p>
         </div>
 